@@ -0,0 +1,150 @@
+#include "miner.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Builds random cave-ins, a block of rock, ladders, supports, dirt and air
+ * with the player somewhere inside holding a few supports, and starts every
+ * rock of about half the rows falling at once. Every fall kernel the CPU
+ * supports lets the same cave-ins settle and has to leave the same save as
+ * ROCK_FALLS, which drops one rock at a time, the time spent settling is
+ * reported. Exits with 1 if any save differs or any incremental hash is off
+ *
+ * Usage: fall [WIDTH] [HEIGHT] [CAVE-INS] [SEED]
+ */
+
+#define CAVE_X 4
+#define CAVE_Y 8
+
+typedef struct {
+    char* data;
+    long size;
+} save_buffer;
+
+static unsigned int rng;
+
+static unsigned int next_random()
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static type random_block()
+{
+    unsigned int r = next_random() % 16;
+    if(r < 6) return AIR;
+    if(r < 10) return ROCK;
+    if(r < 12) return LADDER;
+    if(r < 13) return SUPPORT;
+    return DIRT;
+}
+
+/* Returns how many rocks were started */
+static int build_cave_in(miner_state* s, unsigned int seed, int width, int height)
+{
+    int started = 0;
+    int player_x = CAVE_X + (int)(next_random() % width);
+    int player_y = CAVE_Y + height / 2 + (int)(next_random() % (height - height / 2));
+    miner_new_game(s, seed, 0, 0);
+    for(int y = CAVE_Y; y < CAVE_Y + height; y++) {
+        for(int x = CAVE_X; x < CAVE_X + width; x++) miner_put_block(s, x, y, random_block());
+    }
+    miner_put_block(s, player_x, player_y, AIR);
+    for(int y = CAVE_Y; y < CAVE_Y + height; y++) {
+        if(next_random() % 2) continue;
+        for(int x = CAVE_X; x < CAVE_X + width; x++) {
+            if(miner_block_type(s, x, y) != ROCK) continue;
+            miner_put_block(s, x, y, FALLING_ROCK);
+            started++;
+        }
+    }
+    PLAYER_INT(s, PLAYER_X) = player_x;
+    PLAYER_INT(s, PLAYER_Y) = player_y;
+    PLAYER_INT(s, INV_SUPPORTS) = (int)(next_random() % 4);
+    s->player_hash ^= miner_hash(s) ^ miner_rehash(s);
+    return started;
+}
+
+/* Notices would swallow the keys, the cave-in keeps settling after a rescue */
+static void settle(miner_state* s, int ticks)
+{
+    for(int i = 0; i < ticks; i++) {
+        miner_step(s, NO_OP_KEY);
+        s->notice = NO_NOTICE;
+    }
+}
+
+static boolean save_to_buffer(miner_state* s, save_buffer* b)
+{
+    FILE* f = tmpfile();
+    boolean saved;
+    if(f == NULL) return False;
+    saved = miner_save_stream(s, f, FULL_SAVE) && (b->size = ftell(f)) >= 0
+            && (b->data = malloc(b->size)) != NULL && fseek(f, 0, SEEK_SET) == 0
+            && fread(b->data, 1, b->size, f) == (size_t)b->size;
+    fclose(f);
+    return saved;
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+    int width = (argc > 1) ? atoi(argv[1]) : 512;
+    int height = (argc > 2) ? atoi(argv[2]) : 64;
+    int cave_ins = (argc > 3) ? atoi(argv[3]) : 16;
+    unsigned int seed = (argc > 4) ? (unsigned int)strtoul(argv[4], NULL, 10) : 1;
+    miner_batch* batch = miner_batch_new(1);
+    miner_state* s;
+    double times[TOTAL_FALL_KERNELS] = {0.0};
+    long rocks = 0;
+    int bad[TOTAL_FALL_KERNELS] = {0};
+    boolean failed = False;
+    if(batch == NULL || width < 1 || height < 2 || cave_ins < 1) return -1;
+    s = &batch->states[0];
+    for(int n = 0; n < cave_ins; n++) {
+        save_buffer reference = {NULL, 0};
+        for(int k = ROCK_FALLS; k < TOTAL_FALL_KERNELS; k++) {
+            save_buffer out = {NULL, 0};
+            double start;
+            boolean same;
+            if(!miner_fall_kernel_supported(k)) continue;
+            miner_use_fall_kernel(k);
+            rng = seed * 2654435761u + (unsigned int)n * 40503u + 1;
+            if(k == ROCK_FALLS) rocks += build_cave_in(s, seed + n, width, height);
+            else build_cave_in(s, seed + n, width, height);
+            start = now();
+            settle(s, 2 * height + 2 * FALL_WHEEL_SIZE);
+            times[k] += now() - start;
+            if(miner_hash(s) != miner_rehash(s)) bad[k]++;
+            if(!save_to_buffer(s, (k == ROCK_FALLS) ? &reference : &out)) bad[k]++;
+            same = (boolean)(k == ROCK_FALLS
+                             || (out.size == reference.size && memcmp(out.data, reference.data, out.size) == 0));
+            if(!same) bad[k]++;
+            free(out.data);
+        }
+        free(reference.data);
+    }
+    printf("%d cave-ins of %d x %d, %ld rocks started\n", cave_ins, width, height, rocks);
+    for(int k = ROCK_FALLS; k < TOTAL_FALL_KERNELS; k++) {
+        if(!miner_fall_kernel_supported(k)) {
+            printf("%-8s not supported\n", miner_fall_kernel_name(k));
+            continue;
+        }
+        if(bad[k] > 0) failed = True;
+        printf("%-8s %.3fs, %.2fx%s\n", miner_fall_kernel_name(k), times[k], times[ROCK_FALLS] / times[k],
+               (bad[k] > 0) ? ", CAVE-INS DIFFER" : "");
+    }
+    miner_batch_free(batch);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,166 @@
+#include "generate.h"
+#include "miner.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Generates the same region with every kernel the CPU supports, checks the
+ * output against the scalar kernel and reports the speedup. Then checks the
+ * mass of every block in the alias tables against its chance in the old
+ * threshold cascade at every depth down to where platinum starts, and
+ * compares how often every block shows up with those chances at the top of
+ * every depth band. Exits with 1 if any kernel's output differs from the
+ * scalar one or any mass is more than MASS_TOLERANCE off
+ *
+ * Usage: generate [WIDTH] [HEIGHT] [SEED]
+ */
+
+#define SPAWN_AREA_END 16
+
+#define ONE_IN(n) (0xFFFFFFFFu / (unsigned int)(n))
+#define TOTAL_MASS 4294967296.0L
+
+/* The masses are rounded to whole parts in 2^32 */
+#define MASS_TOLERANCE 1.0L
+
+static const char* block_names[TOTAL_BLOCKS] = {
+    "Air",
+    "Dirt",
+    "Exit",
+    "Support",
+    "Ladder",
+    "Rock",
+    "Falling",
+    "Coal",
+    "Iron",
+    "Copper",
+    "Silver",
+    "Gold",
+    "Platinum"
+};
+
+static const int band_depths[4] = {
+    IRON_SPAWN_THRESHOLD,
+    COPPER_SPAWN_THRESHOLD,
+    SILVER_SPAWN_THRESHOLD,
+    PLATINUM_SPAWN_THRESHOLD
+};
+
+static long double draw_chance(int y, int spawn_threshold, int chance)
+{
+    return (y >= spawn_threshold) ? ONE_IN(chance) / TOTAL_MASS : 0.0L;
+}
+
+/*
+ * The cascade generation used before the alias tables: a cell is dirt unless
+ * a draw below ONE_IN(2) lets it try platinum down to coal and then rock,
+ * each with its own draw against its own threshold
+ */
+static void cascade_chances(int y, long double chances[])
+{
+    int d = (y >= COPPER_SPAWN_THRESHOLD) + (y >= SILVER_SPAWN_THRESHOLD)
+            + (y >= GOLD_SPAWN_THRESHOLD) + (y >= PLATINUM_SPAWN_THRESHOLD);
+    const long double draws[] = {
+        draw_chance(y, PLATINUM_SPAWN_THRESHOLD, PLATINUM_CHANCE),
+        draw_chance(y, GOLD_SPAWN_THRESHOLD, GOLD_CHANCE),
+        draw_chance(y, SILVER_SPAWN_THRESHOLD, SILVER_CHANCE),
+        draw_chance(y, COPPER_SPAWN_THRESHOLD, COPPER_CHANCE),
+        draw_chance(y, IRON_SPAWN_THRESHOLD, IRON_CHANCE),
+        draw_chance(y, COAL_SPAWN_THRESHOLD, COAL_CHANCE),
+        ONE_IN(ROCK_CHANCE - 4 * d) / TOTAL_MASS
+    };
+    const type draw_blocks[] = {PLATINUM_BLOCK, GOLD_BLOCK, SILVER_BLOCK, COPPER_BLOCK, IRON_BLOCK, COAL_BLOCK, ROCK};
+    long double left = ONE_IN(2) / TOTAL_MASS;
+    for(int b = 0; b < TOTAL_BLOCKS; b++) chances[b] = 0.0L;
+    chances[DIRT] = 1.0L;
+    for(int n = 0; n < (int)(sizeof(draws) / sizeof(draws[0])); n++) {
+        chances[draw_blocks[n]] = left * draws[n];
+        chances[DIRT] -= chances[draw_blocks[n]];
+        left -= chances[draw_blocks[n]];
+    }
+}
+
+/* Returns how many block masses are off, printing every one of them */
+static int check_masses()
+{
+    int bad = 0;
+    long double worst = 0.0L;
+    for(int y = 1; y <= PLATINUM_SPAWN_THRESHOLD; y++) {
+        long double chances[TOTAL_BLOCKS];
+        unsigned long long masses[TOTAL_BLOCKS];
+        cascade_chances(y, chances);
+        generate_block_masses(y, masses);
+        for(int b = 0; b < TOTAL_BLOCKS; b++) {
+            long double error = masses[b] - chances[b] * TOTAL_MASS;
+            if(error < 0.0L) error = -error;
+            if(error > worst) worst = error;
+            if(error <= MASS_TOLERANCE) continue;
+            printf("depth %d: %s mass %llu, cascade %.3Lf\n", y, block_names[b], masses[b], chances[b] * TOTAL_MASS);
+            bad++;
+        }
+    }
+    printf("masses %s, worst error %.3Lf parts in 2^32\n", (bad == 0) ? "match" : "DIFFER", worst);
+    return bad;
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+    int width = (argc > 1) ? atoi(argv[1]) : 4096;
+    int height = (argc > 2) ? atoi(argv[2]) : 4096;
+    unsigned int seed = (argc > 3) ? (unsigned int)strtoul(argv[3], NULL, 10) : 1;
+    size_t cells = (size_t)width * height;
+    type* reference = malloc(cells);
+    type* out = malloc(cells);
+    double scalar_time = 0.0;
+    boolean failed = False;
+    if(reference == NULL || out == NULL) return -1;
+    for(int k = SCALAR_KERNEL; k < TOTAL_GENERATE_KERNELS; k++) {
+        double start, elapsed;
+        boolean same;
+        type* dst = (k == SCALAR_KERNEL) ? reference : out;
+        if(!generate_kernel_supported(k)) {
+            printf("%-7s not supported\n", generate_kernel_name(k));
+            continue;
+        }
+        generate_use_kernel(k);
+        start = now();
+        for(int y = 0; y < height; y++) generate_row(seed, 0, y, width, dst + (size_t)y * width);
+        elapsed = now() - start;
+        if(k == SCALAR_KERNEL) scalar_time = elapsed;
+        same = (boolean)(k == SCALAR_KERNEL || memcmp(reference, out, cells) == 0);
+        if(!same) failed = True;
+        printf("%-7s %.3fs, %.1f Mcells/s, %.2fx%s\n", generate_kernel_name(k), elapsed,
+               cells / elapsed / 1e6, scalar_time / elapsed, same ? "" : ", OUTPUT DIFFERS");
+    }
+    if(check_masses() > 0) failed = True;
+    for(int i = 0; i < 4; i++) {
+        long double chances[TOTAL_BLOCKS];
+        size_t counts[TOTAL_BLOCKS] = {0};
+        int y = band_depths[i];
+        cascade_chances(y, chances);
+        for(int row = 0; row < height; row++) {
+            generate_row(seed + row, SPAWN_AREA_END, y, width, out);
+            for(int x = 0; x < width; x++) counts[out[x]]++;
+        }
+        printf("depth %d:\n", y);
+        for(int b = 0; b < TOTAL_BLOCKS; b++) {
+            double expected = (double)(chances[b] * cells);
+            if(counts[b] == 0 && expected == 0.0) continue;
+            printf("  %-8s expected %12.1f, got %10zu, %.4fx\n", block_names[b], expected, counts[b],
+                   (expected > 0.0) ? counts[b] / expected : 0.0);
+        }
+    }
+    free(out);
+    free(reference);
+    return failed ? 1 : 0;
+}
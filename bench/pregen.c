@@ -0,0 +1,60 @@
+#include "miner.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Pregenerates the same area single threaded and with every thread count up
+ * to THREADS, checks every block against the single threaded mine and reports
+ * the speedup. Exits with 1 if any thread count generates a different mine
+ *
+ * Usage: pregen [SIZE] [THREADS] [SEED]
+ */
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+    int size = (argc > 1) ? atoi(argv[1]) : 4096;
+    int max_threads = (argc > 2) ? atoi(argv[2]) : 8;
+    unsigned int seed = (argc > 3) ? (unsigned int)strtoul(argv[3], NULL, 10) : 1;
+    miner_batch* b = miner_batch_new(2);
+    miner_state* reference;
+    miner_state* s;
+    double single_time = 0.0;
+    boolean failed = False;
+    if(b == NULL) return -1;
+    reference = &b->states[0];
+    s = &b->states[1];
+    miner_init(reference);
+    reference->seed = seed;
+    for(int threads = 1; threads <= max_threads; threads *= 2) {
+        double start, elapsed;
+        boolean same = True;
+        miner_state* dst = (threads == 1) ? reference : s;
+        miner_init(dst);
+        dst->seed = seed;
+        start = now();
+        miner_generate(dst, size, size, threads);
+        elapsed = now() - start;
+        if(threads == 1) single_time = elapsed;
+        for(int y = 0; y < size && same && dst != reference; y++) {
+            for(int x = 0; x < size && same; x++) {
+                block a = miner_get_block(reference, x, y);
+                block c = miner_get_block(s, x, y);
+                same = a.block_type == c.block_type && a.health == c.health;
+            }
+        }
+        printf("%2d threads %.3fs, %.1f Mcells/s, %.2fx%s\n", threads, elapsed,
+               (double)size * size / elapsed / 1e6, single_time / elapsed, same ? "" : ", OUTPUT DIFFERS");
+        if(!same) failed = True;
+    }
+    miner_batch_free(b);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,151 @@
+#define _XOPEN_SOURCE 700
+
+#include "miner.h"
+#include "render.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+
+/*
+ * Draws the same stream of frames with every renderer into a pseudo
+ * terminal and reports the write() calls, bytes and time each one needs per
+ * frame, the pseudo terminal is drained on another thread
+ *
+ * Usage: render [FRAMES] [SEED]
+ */
+
+#define TERMINAL_WIDTH 120
+#define TERMINAL_HEIGHT 50
+
+static const char keys[] = {
+    MOVE_UP, MOVE_DOWN, MOVE_LEFT, MOVE_RIGHT,
+    MOVE_DOWN, MOVE_RIGHT, MOVE_DOWN, MOVE_LEFT,
+    NO_OP_KEY, NO_OP_KEY, NO_OP_KEY, NO_OP_KEY,
+    DIG_KEY, MENU_SELECT
+};
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned int next_key_seed(unsigned int k)
+{
+    k ^= k << 13;
+    k ^= k >> 17;
+    k ^= k << 5;
+    return k;
+}
+
+/* write() calls and bytes written by the whole process so far */
+static void write_counts(long* calls, long* bytes)
+{
+    char line[64];
+    FILE* f = fopen("/proc/self/io", "r");
+    *calls = *bytes = 0;
+    if(f == NULL) return;
+    while(fgets(line, sizeof(line), f) != NULL) {
+        if(strncmp(line, "wchar:", 6) == 0) *bytes = atol(line + 6);
+        else if(strncmp(line, "syscw:", 6) == 0) *calls = atol(line + 6);
+    }
+    fclose(f);
+}
+
+static void* drain(void* arg)
+{
+    int fd = *(int*)arg;
+    char buf[65536];
+    while(read(fd, buf, sizeof(buf)) > 0);
+    return NULL;
+}
+
+static void draw(miner_state* s)
+{
+    int camera_x = PLAYER_INT(s, CAMERA_X);
+    int camera_y = PLAYER_INT(s, CAMERA_Y);
+    int y = 1;
+    clrscrb();
+    for(int cy = 0; cy < CAMERA_HEIGHT; cy++) {
+        for(int cx = 0; cx < CAMERA_WIDTH; cx++) {
+            if(miner_is_visible(s, cx + camera_x, cy + camera_y)) {
+                type t = miner_block_type(s, cx + camera_x, cy + camera_y);
+                wrtscrb(cx, cy, miner_symbol(t), miner_color(t));
+            }
+        }
+    }
+    wrtscrb(PLAYER_INT(s, PLAYER_SCR_X), PLAYER_INT(s, PLAYER_SCR_Y), '@', 15);
+    prtscrb();
+    render_move(y, CAMERA_WIDTH + 2);
+    render_printw("Money: $%d", PLAYER_INT(s, MONEY));
+    render_clrtoeol();
+    y += 2;
+    render_move(y, CAMERA_WIDTH + 2);
+    render_printw("Stamina: %d/%d", PLAYER_INT(s, STAMINA), max_stamina);
+    render_clrtoeol();
+    y += 2;
+    render_move(y, CAMERA_WIDTH + 2);
+    render_printw("Total ore: %d/%d", PLAYER_INT(s, INV_ORE), PLAYER_INT(s, MAX_ORE));
+    render_clrtoeol();
+    y += 2;
+    render_move(y, CAMERA_WIDTH + 2);
+    render_printw("Coordinates: %d %d", PLAYER_INT(s, PLAYER_X), PLAYER_INT(s, PLAYER_Y));
+    render_clrtoeol();
+}
+
+int main(int argc, char** argv)
+{
+    long frames = (argc > 1) ? atol(argv[1]) : 20000;
+    unsigned int seed = (argc > 2) ? (unsigned int)strtoul(argv[2], NULL, 10) : 1;
+    struct winsize ws = {TERMINAL_HEIGHT, TERMINAL_WIDTH, 0, 0};
+    miner_batch* b = miner_batch_new(1);
+    miner_state* s;
+    pthread_t drainer;
+    FILE* out;
+    int master, slave;
+    if(b == NULL || frames < 1) return -1;
+    s = &b->states[0];
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return -1;
+    slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    if(slave < 0) return -1;
+    ioctl(slave, TIOCSWINSZ, &ws);
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    if(out == NULL) return -1;
+    dup2(slave, STDIN_FILENO);
+    dup2(slave, STDOUT_FILENO);
+    setenv("TERM", "xterm-256color", 1);
+    pthread_create(&drainer, NULL, drain, &master);
+    for(type r = CURSES_RENDERER; r < TOTAL_RENDERERS; r++) {
+        unsigned int key_seed = seed;
+        long calls, bytes, end_calls, end_bytes;
+        double start, elapsed;
+        miner_new_game(s, seed, 0, 0);
+        render_use(r);
+        render_init();
+        rszscrb(CAMERA_WIDTH, CAMERA_HEIGHT);
+        write_counts(&calls, &bytes);
+        start = now();
+        for(long n = 0; n < frames; n++) {
+            key_seed = next_key_seed(key_seed);
+            miner_step(s, keys[key_seed % sizeof(keys)]);
+            s->game_running = True;
+            draw(s);
+            render_refresh();
+        }
+        elapsed = now() - start;
+        write_counts(&end_calls, &end_bytes);
+        render_end();
+        fprintf(out, "%-7s %.2f writes/frame, %.0f bytes/frame, %.1fus/frame\n", render_name(r),
+                (double)(end_calls - calls) / frames, (double)(end_bytes - bytes) / frames, elapsed / frames * 1e6);
+    }
+    fclose(out);
+    miner_batch_free(b);
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "miner.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Drives a batch of headless mines with random key streams and reports how
+ * many steps per second the core manages, no terminal involved. Then every
+ * player gets SHOP_MONEY and buys upgrades and items in the shop, since
+ * random keys never earn enough for that. The incremental hash of every
+ * instance is checked before and after, a wrong one exits with 1
+ *
+ * Usage: step [STEPS PER INSTANCE] [INSTANCES]
+ */
+
+static const char keys[] = {
+    MOVE_UP, MOVE_DOWN, MOVE_LEFT, MOVE_RIGHT,
+    ACTION_UP, ACTION_DOWN, ACTION_LEFT, ACTION_RIGHT,
+    MOVE_DOWN, MOVE_RIGHT, ACTION_DOWN, ACTION_RIGHT,
+    PLACE_LADDER_KEY, PLACE_SUPPORT_KEY, DIG_KEY, AUTO_DIG_KEY,
+    NO_OP_KEY, MENU_SELECT
+};
+
+#define SHOP_MONEY 100000
+
+/* From the top of the menu into the shop, buying a bit of everything */
+static const char shop_keys[] = {
+    MENU_UP, MENU_UP, MENU_UP, MENU_DOWN, MENU_SELECT,
+    MENU_SELECT, MENU_SELECT,
+    MENU_DOWN, MENU_SELECT, MENU_SELECT, MENU_SELECT, MENU_SELECT,
+    MENU_DOWN, MENU_SELECT, MENU_SELECT,
+    MENU_DOWN, MENU_SELECT, MENU_SELECT,
+    MENU_DOWN, MENU_SELECT, MENU_SELECT,
+    MENU_DOWN, MENU_SELECT, MENU_SELECT,
+    MENU_DOWN, MENU_SELECT,
+    MENU_UP, MENU_UP, MENU_UP, MENU_SELECT
+};
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Money is handed out past the core, so the incremental hash is brought in
+ * line with the new money before shopping, hash mismatches from before are
+ * counted first
+ */
+static void go_shopping(miner_state* s)
+{
+    PLAYER_INT(s, MONEY) += SHOP_MONEY;
+    s->player_hash ^= miner_hash(s) ^ miner_rehash(s);
+    s->notice = NO_NOTICE;
+    s->menu = True;
+    s->shop = False;
+    for(size_t i = 0; i < sizeof(shop_keys); i++) miner_step(s, shop_keys[i]);
+}
+
+static unsigned int next_key_seed(unsigned int k)
+{
+    k ^= k << 13;
+    k ^= k >> 17;
+    k ^= k << 5;
+    return k;
+}
+
+int main(int argc, char** argv)
+{
+    long steps = (argc > 1) ? atol(argv[1]) : 1000000;
+    int count = (argc > 2) ? atoi(argv[2]) : 1;
+    miner_batch* b = miner_batch_new(count);
+    unsigned int* seeds = malloc(sizeof(unsigned int) * count);
+    unsigned int* key_seeds = malloc(sizeof(unsigned int) * count);
+    int* step_keys = malloc(sizeof(int) * count);
+    long rescues = 0;
+    int hash_mismatches = 0, bag_upgrades = 0;
+    boolean failed;
+    double start, elapsed;
+    if(b == NULL || seeds == NULL || key_seeds == NULL || step_keys == NULL) return -1;
+    for(int i = 0; i < count; i++) {
+        seeds[i] = i + 1;
+        key_seeds[i] = i + 1;
+    }
+    start = now();
+    miner_batch_new_games(b, seeds);
+    elapsed = now() - start;
+    printf("generated %d mines in %.3fs\n", count, elapsed);
+    start = now();
+    for(long n = 0; n < steps; n++) {
+        for(int i = 0; i < count; i++) {
+            key_seeds[i] = next_key_seed(key_seeds[i]);
+            step_keys[i] = keys[key_seeds[i] % sizeof(keys)];
+        }
+        miner_step_batch(b, step_keys);
+        for(int i = 0; i < count; i++) b->states[i].game_running = True;
+    }
+    elapsed = now() - start;
+    for(int i = 0; i < count; i++) rescues += b->ints[TIMES_RESCUED][i];
+    printf("%ld steps in %.3fs, %.0f steps/s\n", steps * count, elapsed, steps * count / elapsed);
+    printf("rescues across all instances: %ld\n", rescues);
+    for(int i = 0; i < count; i++) {
+        if(miner_hash(&b->states[i]) != miner_rehash(&b->states[i])) hash_mismatches++;
+    }
+    printf("instances whose incremental hash is wrong: %d\n", hash_mismatches);
+    failed = (boolean)(hash_mismatches > 0);
+    hash_mismatches = 0;
+    for(int i = 0; i < count; i++) {
+        go_shopping(&b->states[i]);
+        if(PLAYER_TYPE(&b->states[i], PLAYER_BAG_TIER) > 0) bag_upgrades++;
+        if(miner_hash(&b->states[i]) != miner_rehash(&b->states[i])) hash_mismatches++;
+    }
+    printf("instances with a bigger bag after shopping: %d\n", bag_upgrades);
+    printf("instances whose incremental hash is wrong after shopping: %d\n", hash_mismatches);
+    if(hash_mismatches > 0) failed = True;
+    free(step_keys);
+    free(key_seeds);
+    free(seeds);
+    miner_batch_free(b);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,391 @@
+#include "generate.h"
+#include "miner.h"
+
+#include <string.h>
+#include <pthread.h>
+
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+
+#define GENERATE_SIMD
+
+#include <immintrin.h>
+
+#endif
+
+/*
+ * Block generation is counter based, every cell is a hash of the seed and the
+ * cell coordinates so any cell can be generated on its own and in any order.
+ * The hash is the only draw, its top bits pick a column of the depth band's
+ * alias table and the rest decide between the column's block and its alias
+ */
+typedef enum {
+    DIRT_DRAW = DEFAULT,
+    ROCK_DRAW,
+    PLATINUM_DRAW,
+    GOLD_DRAW,
+    SILVER_DRAW,
+    COPPER_DRAW,
+    IRON_DRAW,
+    COAL_DRAW,
+    TOTAL_DRAWS
+} block_draws;
+
+#define ONE_IN(n) (0xFFFFFFFFu / (unsigned int)(n))
+
+#define SPAWN_AREA_SIZE 10
+
+#define ALIAS_COLUMNS TOTAL_DRAWS
+#define ALIAS_SHIFT 29
+#define ALIAS_MASK ((1u << ALIAS_SHIFT) - 1)
+#define ALIAS_COLUMN_MASS (1ull << ALIAS_SHIFT)
+
+static const type draw_blocks[TOTAL_DRAWS] = {
+    DIRT,
+    ROCK,
+    PLATINUM_BLOCK,
+    GOLD_BLOCK,
+    SILVER_BLOCK,
+    COPPER_BLOCK,
+    IRON_BLOCK,
+    COAL_BLOCK
+};
+
+/* Depth bands start where an ore starts spawning, in spawn order */
+typedef enum {
+    SURFACE_BAND = DEFAULT,
+    COAL_BAND,
+    IRON_BAND,
+    COPPER_BAND,
+    SILVER_BAND,
+    GOLD_BAND,
+    PLATINUM_BAND,
+    TOTAL_BANDS
+} depth_bands;
+
+static const int band_starts[TOTAL_BANDS] = {
+    0,
+    COAL_SPAWN_THRESHOLD,
+    IRON_SPAWN_THRESHOLD,
+    COPPER_SPAWN_THRESHOLD,
+    SILVER_SPAWN_THRESHOLD,
+    GOLD_SPAWN_THRESHOLD,
+    PLATINUM_SPAWN_THRESHOLD
+};
+
+/*
+ * Ints so the vector kernels can look columns up directly, accept is out of
+ * ALIAS_COLUMN_MASS
+ */
+typedef struct {
+    int accept[ALIAS_COLUMNS];
+    int blocks[ALIAS_COLUMNS];
+    int aliases[ALIAS_COLUMNS];
+} alias_table;
+
+static alias_table band_tables[TOTAL_BANDS];
+
+typedef struct {
+    unsigned int key;
+    int y;
+    const alias_table* table;
+} row_params;
+
+typedef void (*row_kernel)(const row_params* p, int x, int count, type* out);
+
+static int depth_band(int y)
+{
+    int band = SURFACE_BAND;
+    while(band + 1 < TOTAL_BANDS && y >= band_starts[band + 1]) band++;
+    return band;
+}
+
+static double ore_chance(int y, int spawn_threshold, int chance)
+{
+    return (y >= spawn_threshold) ? ONE_IN(chance) / 4294967296.0 : 0.0;
+}
+
+/*
+ * Chances of every block at depth y for the ore cascade: half the cells are
+ * dirt outright, the rest try platinum down to coal in turn, then rock
+ */
+void generate_block_chances(int y, double chances[])
+{
+    int d = (y >= COPPER_SPAWN_THRESHOLD) + (y >= SILVER_SPAWN_THRESHOLD)
+            + (y >= GOLD_SPAWN_THRESHOLD) + (y >= PLATINUM_SPAWN_THRESHOLD);
+    double draws[TOTAL_DRAWS];
+    double left;
+    memset(chances, 0, sizeof(double) * TOTAL_BLOCKS);
+    if(y <= 0) {
+        chances[DIRT] = 1.0;
+        return;
+    }
+    draws[PLATINUM_DRAW] = ore_chance(y, PLATINUM_SPAWN_THRESHOLD, PLATINUM_CHANCE);
+    draws[GOLD_DRAW] = ore_chance(y, GOLD_SPAWN_THRESHOLD, GOLD_CHANCE);
+    draws[SILVER_DRAW] = ore_chance(y, SILVER_SPAWN_THRESHOLD, SILVER_CHANCE);
+    draws[COPPER_DRAW] = ore_chance(y, COPPER_SPAWN_THRESHOLD, COPPER_CHANCE);
+    draws[IRON_DRAW] = ore_chance(y, IRON_SPAWN_THRESHOLD, IRON_CHANCE);
+    draws[COAL_DRAW] = ore_chance(y, COAL_SPAWN_THRESHOLD, COAL_CHANCE);
+    draws[ROCK_DRAW] = ONE_IN(ROCK_CHANCE - 4 * d) / 4294967296.0;
+    left = ONE_IN(2) / 4294967296.0;
+    for(int n = PLATINUM_DRAW; n <= COAL_DRAW; n++) {
+        chances[draw_blocks[n]] = left * draws[n];
+        left -= chances[draw_blocks[n]];
+    }
+    chances[ROCK] = left * draws[ROCK_DRAW];
+    chances[DIRT] = 1.0 - chances[ROCK];
+    for(int n = PLATINUM_DRAW; n <= COAL_DRAW; n++) chances[DIRT] -= chances[draw_blocks[n]];
+}
+
+/*
+ * Vose's method on integer masses so the table hits the cascade's chances to
+ * within one part in 2^32. The masses are rounded running totals, so dirt
+ * taking what is left doesn't pile up the rounding of every other block
+ */
+static void build_alias_table(alias_table* t, int y)
+{
+    double chances[TOTAL_BLOCKS];
+    unsigned long long mass[ALIAS_COLUMNS];
+    unsigned long long total = 0;
+    double running = 0.0;
+    int small[ALIAS_COLUMNS], large[ALIAS_COLUMNS];
+    int small_top = 0, large_top = 0;
+    generate_block_chances(y, chances);
+    for(int n = ROCK_DRAW; n < ALIAS_COLUMNS; n++) {
+        running += chances[draw_blocks[n]];
+        mass[n] = (unsigned long long)(running * 4294967296.0 + 0.5) - total;
+        total += mass[n];
+    }
+    mass[DIRT_DRAW] = ALIAS_COLUMNS * ALIAS_COLUMN_MASS - total;
+    for(int n = 0; n < ALIAS_COLUMNS; n++) {
+        t->blocks[n] = draw_blocks[n];
+        t->aliases[n] = draw_blocks[n];
+        if(mass[n] < ALIAS_COLUMN_MASS) small[small_top++] = n;
+        else large[large_top++] = n;
+    }
+    while(small_top > 0 && large_top > 0) {
+        int l = small[--small_top];
+        int g = large[--large_top];
+        t->accept[l] = (int)mass[l];
+        t->aliases[l] = draw_blocks[g];
+        mass[g] -= ALIAS_COLUMN_MASS - mass[l];
+        if(mass[g] < ALIAS_COLUMN_MASS) small[small_top++] = g;
+        else large[large_top++] = g;
+    }
+    while(small_top > 0) t->accept[small[--small_top]] = (int)ALIAS_COLUMN_MASS;
+    while(large_top > 0) t->accept[large[--large_top]] = (int)ALIAS_COLUMN_MASS;
+}
+
+void generate_block_masses(int y, unsigned long long masses[])
+{
+    const alias_table* t = &band_tables[depth_band(y)];
+    generate_init();
+    memset(masses, 0, sizeof(unsigned long long) * TOTAL_BLOCKS);
+    if(y <= 0) {
+        masses[DIRT] = ALIAS_COLUMNS * ALIAS_COLUMN_MASS;
+        return;
+    }
+    for(int n = 0; n < ALIAS_COLUMNS; n++) {
+        masses[t->blocks[n]] += (unsigned long long)t->accept[n];
+        masses[t->aliases[n]] += ALIAS_COLUMN_MASS - (unsigned long long)t->accept[n];
+    }
+}
+
+static void init_row(row_params* p, unsigned int seed, int y)
+{
+    p->key = mix32(seed ^ mix32((unsigned int)y * ROW_KEY));
+    p->y = y;
+    p->table = &band_tables[depth_band(y)];
+}
+
+static type scalar_block(const row_params* p, int x)
+{
+    unsigned int cell;
+    int column;
+    type bt;
+    if(x <= 0 || p->y <= 0) return DIRT;
+    cell = mix32(p->key ^ (unsigned int)x * COLUMN_KEY);
+    column = cell >> ALIAS_SHIFT;
+    bt = ((int)(cell & ALIAS_MASK) < p->table->accept[column]) ? p->table->blocks[column] : p->table->aliases[column];
+    if(bt == ROCK && x < SPAWN_AREA_SIZE && p->y < SPAWN_AREA_SIZE) return DIRT;
+    return bt;
+}
+
+static void scalar_row(const row_params* p, int x, int count, type* out)
+{
+    for(int i = 0; i < count; i++) out[i] = scalar_block(p, x + i);
+}
+
+#if defined GENERATE_SIMD
+
+/*
+ * The vector kernels look the columns of all lanes up at once, SSE4.2 has no
+ * 32 bit permute so it shuffles bytes out of both halves of the table
+ */
+
+__attribute__((target("sse4.2")))
+static __m128i sse42_mix32(__m128i v)
+{
+    v = _mm_xor_si128(v, _mm_srli_epi32(v, 16));
+    v = _mm_mullo_epi32(v, _mm_set1_epi32((int)0x7FEB352Du));
+    v = _mm_xor_si128(v, _mm_srli_epi32(v, 15));
+    v = _mm_mullo_epi32(v, _mm_set1_epi32((int)0x846CA68Bu));
+    v = _mm_xor_si128(v, _mm_srli_epi32(v, 16));
+    return v;
+}
+
+__attribute__((target("sse4.2")))
+static __m128i sse42_lookup(const int* table, __m128i bytes, __m128i high)
+{
+    __m128i lo = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)table), bytes);
+    __m128i hi = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(table + 4)), bytes);
+    return _mm_blendv_epi8(lo, hi, high);
+}
+
+__attribute__((target("sse4.2")))
+static void sse42_row(const row_params* p, int x, int count, type* out)
+{
+    int i = 0;
+    int lanes[4];
+    const __m128i offsets = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i spread = _mm_setr_epi8(0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12);
+    const __m128i byte_offsets = _mm_set1_epi32(0x03020100);
+    for(; i + 4 <= count; i += 4) {
+        __m128i xs = _mm_add_epi32(_mm_set1_epi32(x + i), offsets);
+        __m128i cell = sse42_mix32(_mm_xor_si128(_mm_set1_epi32((int)p->key), _mm_mullo_epi32(xs, _mm_set1_epi32((int)COLUMN_KEY))));
+        __m128i column = _mm_srli_epi32(cell, ALIAS_SHIFT);
+        __m128i high = _mm_cmpgt_epi32(column, _mm_set1_epi32(3));
+        __m128i bytes = _mm_add_epi8(_mm_shuffle_epi8(_mm_slli_epi32(_mm_and_si128(column, _mm_set1_epi32(3)), 2), spread), byte_offsets);
+        __m128i keep = _mm_cmpgt_epi32(sse42_lookup(p->table->accept, bytes, high), _mm_and_si128(cell, _mm_set1_epi32(ALIAS_MASK)));
+        __m128i bt = _mm_blendv_epi8(sse42_lookup(p->table->aliases, bytes, high), sse42_lookup(p->table->blocks, bytes, high), keep);
+        __m128i dirt = _mm_cmpgt_epi32(_mm_set1_epi32(1), xs);
+        if(p->y < SPAWN_AREA_SIZE) {
+            dirt = _mm_or_si128(dirt, _mm_and_si128(_mm_cmpeq_epi32(bt, _mm_set1_epi32(ROCK)), _mm_cmpgt_epi32(_mm_set1_epi32(SPAWN_AREA_SIZE), xs)));
+        }
+        bt = _mm_blendv_epi8(bt, _mm_set1_epi32(DIRT), dirt);
+        _mm_storeu_si128((__m128i*)lanes, bt);
+        for(int j = 0; j < 4; j++) out[i + j] = (type)lanes[j];
+    }
+    scalar_row(p, x + i, count - i, out + i);
+}
+
+__attribute__((target("avx2")))
+static __m256i avx2_mix32(__m256i v)
+{
+    v = _mm256_xor_si256(v, _mm256_srli_epi32(v, 16));
+    v = _mm256_mullo_epi32(v, _mm256_set1_epi32((int)0x7FEB352Du));
+    v = _mm256_xor_si256(v, _mm256_srli_epi32(v, 15));
+    v = _mm256_mullo_epi32(v, _mm256_set1_epi32((int)0x846CA68Bu));
+    v = _mm256_xor_si256(v, _mm256_srli_epi32(v, 16));
+    return v;
+}
+
+__attribute__((target("avx2")))
+static __m256i avx2_lookup(const int* table, __m256i column)
+{
+    return _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)table), column);
+}
+
+__attribute__((target("avx2")))
+static void avx2_row(const row_params* p, int x, int count, type* out)
+{
+    int i = 0;
+    int lanes[8];
+    const __m256i offsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    for(; i + 8 <= count; i += 8) {
+        __m256i xs = _mm256_add_epi32(_mm256_set1_epi32(x + i), offsets);
+        __m256i cell = avx2_mix32(_mm256_xor_si256(_mm256_set1_epi32((int)p->key), _mm256_mullo_epi32(xs, _mm256_set1_epi32((int)COLUMN_KEY))));
+        __m256i column = _mm256_srli_epi32(cell, ALIAS_SHIFT);
+        __m256i keep = _mm256_cmpgt_epi32(avx2_lookup(p->table->accept, column), _mm256_and_si256(cell, _mm256_set1_epi32(ALIAS_MASK)));
+        __m256i bt = _mm256_blendv_epi8(avx2_lookup(p->table->aliases, column), avx2_lookup(p->table->blocks, column), keep);
+        __m256i dirt = _mm256_cmpgt_epi32(_mm256_set1_epi32(1), xs);
+        if(p->y < SPAWN_AREA_SIZE) {
+            dirt = _mm256_or_si256(dirt, _mm256_and_si256(_mm256_cmpeq_epi32(bt, _mm256_set1_epi32(ROCK)), _mm256_cmpgt_epi32(_mm256_set1_epi32(SPAWN_AREA_SIZE), xs)));
+        }
+        bt = _mm256_blendv_epi8(bt, _mm256_set1_epi32(DIRT), dirt);
+        _mm256_storeu_si256((__m256i*)lanes, bt);
+        for(int j = 0; j < 8; j++) out[i + j] = (type)lanes[j];
+    }
+    scalar_row(p, x + i, count - i, out + i);
+}
+
+static const row_kernel kernels[TOTAL_GENERATE_KERNELS] = {
+    scalar_row,
+    sse42_row,
+    avx2_row
+};
+
+#else
+
+static const row_kernel kernels[TOTAL_GENERATE_KERNELS] = {
+    scalar_row,
+    NULL,
+    NULL
+};
+
+#endif
+
+static const char* kernel_names[TOTAL_GENERATE_KERNELS] = {
+    "scalar",
+    "sse4.2",
+    "avx2"
+};
+
+static type current_kernel = NONE;
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+boolean generate_kernel_supported(type kernel)
+{
+    if(kernel >= TOTAL_GENERATE_KERNELS || kernels[kernel] == NULL) return False;
+#if defined GENERATE_SIMD
+    switch(kernel) {
+    case SSE42_KERNEL:
+        return __builtin_cpu_supports("sse4.2") ? True : False;
+    case AVX2_KERNEL:
+        return __builtin_cpu_supports("avx2") ? True : False;
+    default:
+        break;
+    }
+#endif
+    return True;
+}
+
+static void init_tables()
+{
+    type kernel = AVX2_KERNEL;
+    for(int band = SURFACE_BAND; band < TOTAL_BANDS; band++) build_alias_table(&band_tables[band], band_starts[band]);
+    while(!generate_kernel_supported(kernel)) kernel--;
+    current_kernel = kernel;
+}
+
+void generate_init()
+{
+    pthread_once(&init_once, init_tables);
+}
+
+void generate_use_kernel(type kernel)
+{
+    generate_init();
+    if(generate_kernel_supported(kernel)) current_kernel = kernel;
+}
+
+type generate_current_kernel()
+{
+    generate_init();
+    return current_kernel;
+}
+
+const char* generate_kernel_name(type kernel)
+{
+    return (kernel < TOTAL_GENERATE_KERNELS) ? kernel_names[kernel] : "none";
+}
+
+void generate_row(unsigned int seed, int x, int y, int count, type* out)
+{
+    row_params p;
+    if(y <= 0) {
+        memset(out, DIRT, count);
+        return;
+    }
+    init_row(&p, seed, y);
+    kernels[generate_current_kernel()](&p, x, count, out);
+}
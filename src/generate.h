@@ -0,0 +1,43 @@
+#ifndef GENERATE_H
+#define GENERATE_H
+
+#include "util.h"
+
+#define ROW_KEY 0x85EBCA77u
+#define COLUMN_KEY 0x9E3779B1u
+
+/* Bump whenever the same seed would generate a different mine */
+#define GENERATOR_VERSION 2
+
+typedef enum {
+    SCALAR_KERNEL = DEFAULT,
+    SSE42_KERNEL,
+    AVX2_KERNEL,
+    TOTAL_GENERATE_KERNELS
+} generate_kernels;
+
+/*
+ * Builds the alias tables and picks the fastest kernel the CPU supports the
+ * first time it is called from any thread, later calls keep the tables and
+ * whatever kernel generate_use_kernel() picked since
+ */
+void generate_init();
+
+boolean generate_kernel_supported(type kernel);
+void generate_use_kernel(type kernel);
+type generate_current_kernel();
+const char* generate_kernel_name(type kernel);
+
+/* Chance of every block type at depth y, indexed by block type */
+void generate_block_chances(int y, double chances[]);
+
+/*
+ * Mass of every block type at depth y in the alias table generate_row()
+ * samples from, out of 2^32 and indexed by block type
+ */
+void generate_block_masses(int y, unsigned long long masses[]);
+
+/* Block types of count cells starting at (x, y) going right */
+void generate_row(unsigned int seed, int x, int y, int count, type* out);
+
+#endif /* GENERATE_H */
@@ -0,0 +1,127 @@
+#include "journal.h"
+
+#define JOURNAL_MAGIC "MJNL"
+#define JOURNAL_VERSION 1
+
+typedef struct {
+    char magic[4];
+    int version;
+    unsigned int base;
+} journal_header;
+
+static boolean read_header(FILE* f, journal_header* h, unsigned int* count)
+{
+    long size;
+    if(fread(h, sizeof(journal_header), 1, f) != 1
+       || memcmp(h->magic, JOURNAL_MAGIC, sizeof(h->magic)) != 0
+       || h->version != JOURNAL_VERSION) return False;
+    if(fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < (long)sizeof(journal_header)) return False;
+    *count = (unsigned int)(size - sizeof(journal_header));
+    return True;
+}
+
+static boolean create_journal(const char* fn, unsigned int base, const unsigned char* keys, size_t count)
+{
+    journal_header h;
+    char tmp[FILENAME_MAX];
+    FILE* f;
+    if(snprintf(tmp, sizeof(tmp), "%s.tmp", fn) >= (int)sizeof(tmp)) return False;
+    f = fopen(tmp, "wb");
+    if(f == NULL) return False;
+    memcpy(h.magic, JOURNAL_MAGIC, sizeof(h.magic));
+    h.version = JOURNAL_VERSION;
+    h.base = base;
+    if(fwrite(&h, sizeof(journal_header), 1, f) != 1
+       || fwrite(keys, 1, count, f) != count
+       || fflush(f) == EOF || fsync(fileno(f)) != 0) {
+        fclose(f);
+        return False;
+    }
+    if(fclose(f) == EOF) return False;
+    return (boolean)(rename(tmp, fn) == 0);
+}
+
+boolean journal_open(journal* j, const char* fn, unsigned int steps)
+{
+    journal_header h;
+    FILE* f = fopen(fn, "rb");
+    boolean resume = False;
+    memset(j, 0, sizeof(journal));
+    if(snprintf(j->fn, sizeof(j->fn), "%s", fn) >= (int)sizeof(j->fn)) return False;
+    if(f != NULL) {
+        resume = read_header(f, &h, &j->count) && h.base + j->count == steps;
+        fclose(f);
+    }
+    if(!resume) {
+        if(!create_journal(fn, steps, NULL, 0)) return False;
+        j->count = 0;
+    }
+    j->base = steps - j->count;
+    j->f = fopen(fn, "ab");
+    return (boolean)(j->f != NULL);
+}
+
+void journal_close(journal* j)
+{
+    if(j->f != NULL) fclose(j->f);
+    j->f = NULL;
+}
+
+/* Flushed on every key so the key survives the process dying */
+boolean journal_append(journal* j, int key)
+{
+    if(j->f == NULL || fputc((unsigned char)key, j->f) == EOF || fflush(j->f) == EOF) return False;
+    j->count++;
+    return True;
+}
+
+boolean journal_replay(const char* fn, miner_state* s)
+{
+    journal_header h;
+    unsigned int count;
+    int key;
+    FILE* f = fopen(fn, "rb");
+    if(f == NULL) return False;
+    if(!read_header(f, &h, &count) || h.base > s->steps || h.base + count < s->steps
+       || fseek(f, (long)(sizeof(journal_header) + (s->steps - h.base)), SEEK_SET) != 0) {
+        fclose(f);
+        return False;
+    }
+    while((key = fgetc(f)) != EOF) miner_step(s, key);
+    fclose(f);
+    return True;
+}
+
+boolean journal_compact(journal* j, unsigned int steps)
+{
+    unsigned char* keys;
+    size_t kept;
+    FILE* f;
+    boolean ok;
+    if(steps < j->base || steps > j->base + j->count) return False;
+    kept = j->base + j->count - steps;
+    keys = malloc(kept + 1);
+    f = fopen(j->fn, "rb");
+    if(keys == NULL || f == NULL
+       || fseek(f, (long)(sizeof(journal_header) + (steps - j->base)), SEEK_SET) != 0
+       || fread(keys, 1, kept, f) != kept) {
+        if(f != NULL) fclose(f);
+        free(keys);
+        return False;
+    }
+    fclose(f);
+    journal_close(j);
+    ok = create_journal(j->fn, steps, keys, kept);
+    free(keys);
+    if(ok) {
+        j->base = steps;
+        j->count = (unsigned int)kept;
+    }
+    j->f = fopen(j->fn, "ab");
+    return (boolean)(ok && j->f != NULL);
+}
+
+long journal_size(journal* j)
+{
+    return (long)(sizeof(journal_header) + j->count);
+}
@@ -0,0 +1,33 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "util.h"
+#include "miner.h"
+
+/*
+ * Append only log of every key passed to miner_step() since a save, saves
+ * record how many steps the game had taken so loading can replay the keys
+ * the save missed. Keys are stored as the single byte miner_step() uses
+ */
+typedef struct {
+    FILE* f;
+    char fn[FILENAME_MAX];
+    unsigned int base;
+    unsigned int count;
+} journal;
+
+/* Appends to the journal if it ends at steps, otherwise starts a new one */
+boolean journal_open(journal* j, const char* fn, unsigned int steps);
+void journal_close(journal* j);
+
+boolean journal_append(journal* j, int key);
+
+/* Steps s with the journaled keys it hasn't taken yet */
+boolean journal_replay(const char* fn, miner_state* s);
+
+/* Drops the keys from before steps, once a save has them */
+boolean journal_compact(journal* j, unsigned int steps);
+
+long journal_size(journal* j);
+
+#endif /* JOURNAL_H */
@@ -0,0 +1,1966 @@
+#include "miner.h"
+#include "generate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__) && CHUNK_SIZE == 32
+
+#define FALL_SIMD
+
+#include <immintrin.h>
+
+#endif
+
+#define PLAYER_SYM '@'
+#define DIRT_SYM '#'
+#define ROCK_SYM 'O'
+#define FALLING_ROCK_SYM '!'
+#define ORE_SYM '%'
+#define SUPPORT_SYM '|'
+#define LADDER_SYM 'H'
+#define EXIT_SHAFT_SYM 'H'
+#define AIR_SYM '.'
+
+/*
+ * Everything the core looks up about a block type packed in one word, so the
+ * whole table fits in a cache line: the falling flags in bits 0-2, the ore
+ * type and minimum tier plus one in bits 3-5 and 6-8 (NONE wraps to 0), the
+ * 7 bit symbol in bits 9-15, the color in bits 16-23 and the health in bits
+ * 24-31
+ */
+#define SOLID_FOR_PLAYER 1
+#define SOLID_FOR_ROCKS 2
+#define STOPS_PLAYER 4
+
+#define ORE_TYPE_SHIFT 3
+#define MINIMUM_TIER_SHIFT 6
+#define SYMBOL_SHIFT 9
+#define COLOR_SHIFT 16
+#define HEALTH_SHIFT 24
+
+#define SOLID (SOLID_FOR_PLAYER | SOLID_FOR_ROCKS | STOPS_PLAYER)
+
+#define BLOCK_PROPS(flags, ore_type, minimum_tier, health, symbol, color) \
+    ((unsigned int)(flags) \
+     | (((unsigned int)(ore_type) + 1) & 7) << ORE_TYPE_SHIFT \
+     | (((unsigned int)(minimum_tier) + 1) & 7) << MINIMUM_TIER_SHIFT \
+     | ((unsigned int)(symbol) & 0x7F) << SYMBOL_SHIFT \
+     | ((unsigned int)(color) & 0xFF) << COLOR_SHIFT \
+     | ((unsigned int)(health) & 0xFF) << HEALTH_SHIFT)
+
+static const unsigned int block_props[TOTAL_BLOCKS] = {
+    [AIR] = BLOCK_PROPS(0, NOT_ORE, AIR_MINIMUM_TIER, AIR_HEALTH, AIR_SYM, AIR_COLOR),
+    [DIRT] = BLOCK_PROPS(SOLID, NOT_ORE, DIRT_MINIMUM_TIER, DIRT_HEALTH, DIRT_SYM, DIRT_COLOR),
+    [EXIT_SHAFT] = BLOCK_PROPS(SOLID_FOR_ROCKS | STOPS_PLAYER, NOT_ORE, EXIT_SHAFT_MINIMUM_TIER, EXIT_SHAFT_HEALTH,
+                               EXIT_SHAFT_SYM, EXIT_SHAFT_COLOR),
+    [SUPPORT] = BLOCK_PROPS(SOLID_FOR_ROCKS | STOPS_PLAYER, NOT_ORE, SUPPORT_MINIMUM_TIER, SUPPORT_HEALTH, SUPPORT_SYM,
+                            SUPPORT_COLOR),
+    [LADDER] = BLOCK_PROPS(STOPS_PLAYER, NOT_ORE, LADDER_MINIMUM_TIER, LADDER_HEALTH, LADDER_SYM, LADDER_COLOR),
+    [ROCK] = BLOCK_PROPS(SOLID, NOT_ORE, ROCK_MINIMUM_TIER, ROCK_HEALTH, ROCK_SYM, ROCK_COLOR),
+    [FALLING_ROCK] = BLOCK_PROPS(SOLID, NOT_ORE, ROCK_MINIMUM_TIER, ROCK_HEALTH, FALLING_ROCK_SYM, ROCK_COLOR),
+    [COAL_BLOCK] = BLOCK_PROPS(SOLID, COAL, COAL_MINIMUM_TIER, COAL_HEALTH, ORE_SYM, COAL_COLOR),
+    [IRON_BLOCK] = BLOCK_PROPS(SOLID, IRON, IRON_MINIMUM_TIER, IRON_HEALTH, ORE_SYM, IRON_COLOR),
+    [COPPER_BLOCK] = BLOCK_PROPS(SOLID, COPPER, COPPER_MINIMUM_TIER, COPPER_HEALTH, ORE_SYM, COPPER_COLOR),
+    [SILVER_BLOCK] = BLOCK_PROPS(SOLID, SILVER, SILVER_MINIMUM_TIER, SILVER_HEALTH, ORE_SYM, SILVER_COLOR),
+    [GOLD_BLOCK] = BLOCK_PROPS(SOLID, GOLD, GOLD_MINIMUM_TIER, GOLD_HEALTH, ORE_SYM, GOLD_COLOR),
+    [PLATINUM_BLOCK] = BLOCK_PROPS(SOLID, PLATINUM, PLATINUM_MINIMUM_TIER, PLATINUM_HEALTH, ORE_SYM, PLATINUM_COLOR)
+};
+
+static int ore_price_data[TOTAL_ORE] = {
+    COAL_PRICE,
+    IRON_PRICE,
+    COPPER_PRICE,
+    SILVER_PRICE,
+    GOLD_PRICE,
+    PLATINUM_PRICE
+};
+
+static pickaxe pickaxe_data[7] = {
+    {0, TIER_0_DAMAGE, 0},
+    {1, TIER_1_DAMAGE, TIER_1_PRICE},
+    {2, TIER_2_DAMAGE, TIER_2_PRICE},
+    {3, TIER_3_DAMAGE, TIER_3_PRICE},
+    {4, TIER_4_DAMAGE, TIER_4_PRICE},
+    {5, TIER_5_DAMAGE, TIER_5_PRICE},
+    {6, TIER_6_DAMAGE, TIER_6_PRICE}
+};
+
+static int bag_prices[5] = {
+    0,
+    TIER1_BAG_PRICE,
+    TIER2_BAG_PRICE,
+    TIER3_BAG_PRICE,
+    TIER4_BAG_PRICE
+};
+
+static const int dirs[9][2] = {
+    {-1, -1},
+    {0,  -1},
+    {1,  -1},
+    {-1,  0},
+    {0,   0},
+    {1,   0},
+    {-1,  1},
+    {0,   1},
+    {1,   1}
+};
+
+/* Ticks before a rock drops, a rock knocked loose by one drops a tick sooner */
+static const int rock_fall_ticks = 2;
+
+static const int rescue_multiplier = 4;
+
+static void reveal(miner_state* s, int x, int y);
+static void collapse_supports(miner_state* s, int x, int y);
+
+static void return_to_surface(miner_state* s, type rescue_reason);
+
+static boolean use_coffee(miner_state* s);
+
+static type ctdir(char dir)
+{
+    switch(dir) {
+    case MOVE_UP:
+    case ACTION_UP:
+        return UP;
+    case MOVE_DOWN:
+    case ACTION_DOWN:
+        return DOWN;
+    case MOVE_LEFT:
+    case ACTION_LEFT:
+        return LEFT;
+    case MOVE_RIGHT:
+    case ACTION_RIGHT:
+        return RIGHT;
+    default:
+        return NO_DIRECTION;
+    }
+}
+
+static void move_dir(type dir, int* x, int* y)
+{
+    switch(dir) {
+    case UP:
+        if(y) (*y)--;
+        break;
+    case DOWN:
+        if(y) (*y)++;
+        break;
+    case LEFT:
+        if(x) (*x)--;
+        break;
+    case RIGHT:
+        if(x) (*x)++;
+        break;
+    case NO_DIRECTION:
+    default:
+        break;
+    }
+}
+
+static void generate_chunk(miner_state* s, int cx, int cy, chunk* c);
+
+static unsigned int position_hash(int x, int y)
+{
+    return mix32((unsigned int)x * COLUMN_KEY ^ mix32((unsigned int)y * ROW_KEY));
+}
+
+static chunk_entry* find_entry(chunk_map* m, int cx, int cy)
+{
+    unsigned int i = position_hash(cx, cy) & (m->capacity - 1);
+    while(m->entries[i].c != NULL) {
+        if(m->entries[i].cx == cx && m->entries[i].cy == cy) break;
+        i = (i + 1) & (m->capacity - 1);
+    }
+    return &m->entries[i];
+}
+
+static void grow_chunk_map(chunk_map* m)
+{
+    chunk_entry* old = m->entries;
+    int old_capacity = m->capacity;
+    m->capacity = (old_capacity > 0) ? old_capacity * 2 : 64;
+    m->entries = calloc(m->capacity, sizeof(chunk_entry));
+    if(m->entries == NULL) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(-1);
+    }
+    for(int i = 0; i < old_capacity; i++) {
+        if(old[i].c != NULL) *find_entry(m, old[i].cx, old[i].cy) = old[i];
+    }
+    free(old);
+}
+
+/* The caller has to fill in the chunk of a new entry */
+static chunk_entry* claim_entry(miner_state* s, int cx, int cy)
+{
+    chunk_map* m = &s->chunks;
+    chunk_entry* e;
+    if((m->count + 1) * 2 > m->capacity) grow_chunk_map(m);
+    e = find_entry(m, cx, cy);
+    if(e->c == NULL) {
+        e->cx = cx;
+        e->cy = cy;
+        m->count++;
+    }
+    return e;
+}
+
+static chunk* insert_chunk(miner_state* s, int cx, int cy)
+{
+    chunk_entry* e = claim_entry(s, cx, cy);
+    if(e->c == NULL) {
+        e->c = malloc(sizeof(chunk));
+        if(e->c == NULL) {
+            fprintf(stderr, "Error: Out of memory\n");
+            exit(-1);
+        }
+    }
+    return e->c;
+}
+
+static boolean is_mapped(miner_state* s, chunk* c)
+{
+    char* p = (char*)c;
+    char* start = s->mapped_save;
+    return (boolean)(start != NULL && p >= start && p < start + s->mapped_save_size);
+}
+
+static void free_chunks(miner_state* s)
+{
+    for(int i = 0; i < s->chunks.capacity; i++) {
+        if(!is_mapped(s, s->chunks.entries[i].c)) free(s->chunks.entries[i].c);
+    }
+    free(s->chunks.entries);
+    memset(&s->chunks, 0, sizeof(chunk_map));
+    memset(s->recent_chunks, 0, sizeof(s->recent_chunks));
+    free(s->healths.entries);
+    memset(&s->healths, 0, sizeof(health_map));
+    if(s->mapped_save != NULL) munmap(s->mapped_save, s->mapped_save_size);
+    s->mapped_save = NULL;
+    s->mapped_save_size = 0;
+}
+
+static chunk* get_chunk(miner_state* s, int cx, int cy)
+{
+    chunk_entry* recent = &s->recent_chunks[RECENT_CHUNK_SLOT(cx, cy)];
+    chunk* c;
+    if(recent->c != NULL && recent->cx == cx && recent->cy == cy) return recent->c;
+    c = (s->chunks.capacity > 0) ? find_entry(&s->chunks, cx, cy)->c : NULL;
+    if(c == NULL) {
+        c = insert_chunk(s, cx, cy);
+        generate_chunk(s, cx, cy, c);
+    }
+    recent->cx = cx;
+    recent->cy = cy;
+    recent->c = c;
+    return c;
+}
+
+static chunk* cell_chunk(miner_state* s, int x, int y)
+{
+    return get_chunk(s, x >> CHUNK_SHIFT, y >> CHUNK_SHIFT);
+}
+
+static type get_block_type(miner_state* s, int x, int y)
+{
+    return cell_chunk(s, x, y)->types[y & CHUNK_MASK][x & CHUNK_MASK];
+}
+
+static boolean is_visible(miner_state* s, int x, int y)
+{
+    return (boolean)((cell_chunk(s, x, y)->visible[y & CHUNK_MASK] >> (x & CHUNK_MASK)) & 1u);
+}
+
+static int get_ore_price(type type)
+{
+    return ore_price_data[type];
+}
+
+static char get_block_health(type t)
+{
+    return (char)(signed char)(block_props[t] >> HEALTH_SHIFT);
+}
+
+/* The health a cell of the type is generated with */
+static char default_health(int x, int y, type t)
+{
+    return (x <= 0 || y <= 0) ? -1 : get_block_health(t);
+}
+
+static health_entry* find_health(health_map* m, int x, int y)
+{
+    unsigned int i = position_hash(x, y) & (m->capacity - 1);
+    while(m->entries[i].used) {
+        if(m->entries[i].x == x && m->entries[i].y == y) break;
+        i = (i + 1) & (m->capacity - 1);
+    }
+    return &m->entries[i];
+}
+
+static void grow_health_map(health_map* m)
+{
+    health_entry* old = m->entries;
+    int old_capacity = m->capacity;
+    m->capacity = (old_capacity > 0) ? old_capacity * 2 : 64;
+    m->entries = calloc(m->capacity, sizeof(health_entry));
+    if(m->entries == NULL) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(-1);
+    }
+    for(int i = 0; i < old_capacity; i++) {
+        if(old[i].used) *find_health(m, old[i].x, old[i].y) = old[i];
+    }
+    free(old);
+}
+
+/* Moves later entries of the probe run back so lookups never hit a hole */
+static void remove_health(health_map* m, health_entry* e)
+{
+    unsigned int mask = (unsigned int)m->capacity - 1;
+    unsigned int hole = (unsigned int)(e - m->entries);
+    unsigned int i = hole;
+    m->entries[hole].used = False;
+    m->count--;
+    for(;;) {
+        unsigned int home;
+        i = (i + 1) & mask;
+        if(!m->entries[i].used) return;
+        home = position_hash(m->entries[i].x, m->entries[i].y) & mask;
+        if(((i - home) & mask) < ((i - hole) & mask)) continue;
+        m->entries[hole] = m->entries[i];
+        m->entries[i].used = False;
+        hole = i;
+    }
+}
+
+static char get_health(miner_state* s, int x, int y, type t)
+{
+    health_entry* e;
+    if(s == NULL || s->healths.count == 0) return default_health(x, y, t);
+    e = find_health(&s->healths, x, y);
+    return (e->used) ? e->health : default_health(x, y, t);
+}
+
+static void insert_health(health_map* m, int x, int y, char health)
+{
+    health_entry* e;
+    if((m->count + 1) * 2 > m->capacity) grow_health_map(m);
+    e = find_health(m, x, y);
+    if(!e->used) {
+        e->x = x;
+        e->y = y;
+        e->used = True;
+        m->count++;
+    }
+    e->health = health;
+}
+
+/* Only health that differs from the default is kept */
+static void store_health(miner_state* s, int x, int y, type t, char health)
+{
+    health_entry* e;
+    if(health != default_health(x, y, t)) insert_health(&s->healths, x, y, health);
+    else if(s->healths.count > 0 && (e = find_health(&s->healths, x, y))->used) remove_health(&s->healths, e);
+}
+
+/*
+ * A cell the way saves and the hash see it, with VISIBLE in the type. Cells
+ * of chunks outside the mine, like freshly generated ones, pass no state
+ */
+static block chunk_block(miner_state* s, chunk* c, int x, int y)
+{
+    int lx = x & CHUNK_MASK, ly = y & CHUNK_MASK;
+    type t = c->types[ly][lx];
+    block b;
+    b.block_type = t | (((c->visible[ly] >> lx) & 1u) ? VISIBLE : 0);
+    b.health = get_health(s, x, y, t);
+    return b;
+}
+
+static void set_chunk_block(miner_state* s, chunk* c, int x, int y, block b)
+{
+    int lx = x & CHUNK_MASK, ly = y & CHUNK_MASK;
+    c->types[ly][lx] = b.block_type & ~VISIBLE;
+    if(b.block_type & VISIBLE) c->visible[ly] |= 1u << lx;
+    else c->visible[ly] &= ~(1u << lx);
+    store_health(s, x, y, b.block_type & ~VISIBLE, b.health);
+}
+
+#define PLAYER_TYPE_KEY(f) (TOTAL_PLAYER_INTS + (f))
+
+static unsigned long long cell_key(int x, int y, type block_type, char health)
+{
+    unsigned long long pos = (unsigned long long)(unsigned int)x << 32 | (unsigned int)y;
+    return mix64(mix64(pos) ^ ((unsigned long long)block_type << 8 | (unsigned char)health));
+}
+
+static unsigned long long field_key(int field, int value)
+{
+    if(field == PLAYER_SCR_X || field == PLAYER_SCR_Y || field == CAMERA_X || field == CAMERA_Y) return 0;
+    return mix64((unsigned long long)field << 32 ^ (unsigned int)value ^ 0x9E3779B97F4A7C15ull);
+}
+
+static void mark_stops(chunk* c, int lx, int ly, type block_type)
+{
+    unsigned int bit = 1u << ly;
+    if(block_props[block_type] & STOPS_PLAYER) c->stops_player[lx] |= bit;
+    else c->stops_player[lx] &= ~bit;
+    if(block_props[block_type] & SOLID_FOR_ROCKS) c->stops_rocks[lx] |= bit;
+    else c->stops_rocks[lx] &= ~bit;
+}
+
+static void mark_chunk(chunk* c)
+{
+    for(int lx = 0; lx < CHUNK_SIZE; lx++) {
+        for(int ly = 0; ly < CHUNK_SIZE; ly++) mark_stops(c, lx, ly, c->types[ly][lx]);
+    }
+}
+
+/* First y below the given one whose cell stops a falling rock or player */
+static int next_stop(miner_state* s, int x, int y, boolean rocks)
+{
+    int lx = x & CHUNK_MASK;
+    int cy = (y + 1) >> CHUNK_SHIFT;
+    unsigned int mask = ~0u << ((y + 1) & CHUNK_MASK);
+    for(;;) {
+        chunk* c = get_chunk(s, x >> CHUNK_SHIFT, cy);
+        unsigned int stops = ((rocks) ? c->stops_rocks[lx] : c->stops_player[lx]) & mask;
+        if(stops != 0) return cy * CHUNK_SIZE + lowest_bit(stops);
+        cy++;
+        mask = ~0u;
+    }
+}
+
+/* Every cell write goes through here to keep mine_hash in step */
+static void set_block(miner_state* s, int x, int y, type block_type, char health)
+{
+    chunk* c = cell_chunk(s, x, y);
+    int lx = x & CHUNK_MASK, ly = y & CHUNK_MASK;
+    block old = chunk_block(s, c, x, y);
+    block b;
+    b.block_type = block_type;
+    b.health = health;
+    s->mine_hash ^= cell_key(x, y, old.block_type, old.health) ^ cell_key(x, y, block_type, health);
+    set_chunk_block(s, c, x, y, b);
+    if((old.block_type ^ block_type) & ~VISIBLE) mark_stops(c, lx, ly, block_type & ~VISIBLE);
+}
+
+static void set_health(miner_state* s, int x, int y, char health)
+{
+    block b = chunk_block(s, cell_chunk(s, x, y), x, y);
+    set_block(s, x, y, b.block_type, health);
+}
+
+static void put_block(miner_state* s, int x, int y, type block_type)
+{
+    set_block(s, x, y, block_type, get_block_health(block_type));
+}
+
+static void put_visible_block(miner_state* s, int x, int y, type block_type)
+{
+    set_block(s, x, y, block_type | VISIBLE, get_block_health(block_type));
+}
+
+/* Showing a cell only sets its bit, the hash changes like any other write */
+static void show_cell(miner_state* s, chunk* c, int x, int y)
+{
+    int lx = x & CHUNK_MASK, ly = y & CHUNK_MASK;
+    type t = c->types[ly][lx];
+    char health = get_health(s, x, y, t);
+    s->mine_hash ^= cell_key(x, y, t, health) ^ cell_key(x, y, t | VISIBLE, health);
+    c->visible[ly] |= 1u << lx;
+}
+
+static void set_player_int(miner_state* s, type f, int v)
+{
+    s->player_hash ^= field_key(f, PLAYER_INT(s, f)) ^ field_key(f, v);
+    PLAYER_INT(s, f) = v;
+}
+
+static void add_player_int(miner_state* s, type f, int d)
+{
+    set_player_int(s, f, PLAYER_INT(s, f) + d);
+}
+
+static void set_player_type(miner_state* s, type f, type v)
+{
+    s->player_hash ^= field_key(PLAYER_TYPE_KEY(f), PLAYER_TYPE(s, f)) ^ field_key(PLAYER_TYPE_KEY(f), v);
+    PLAYER_TYPE(s, f) = v;
+}
+
+static void show_block(miner_state* s, int x, int y)
+{
+    chunk* c = cell_chunk(s, x, y);
+    if(!((c->visible[y & CHUNK_MASK] >> (x & CHUNK_MASK)) & 1u)) show_cell(s, c, x, y);
+}
+
+static type get_ore_type(type t)
+{
+    return (type)(((block_props[t] >> ORE_TYPE_SHIFT) & 7) - 1);
+}
+
+static type get_minimum_tier(type t)
+{
+    return (type)(((block_props[t] >> MINIMUM_TIER_SHIFT) & 7) - 1);
+}
+
+static unsigned char get_color(type t)
+{
+    return (unsigned char)(block_props[t] >> COLOR_SHIFT);
+}
+
+static char get_symbol(type t)
+{
+    return (char)((block_props[t] >> SYMBOL_SHIFT) & 0x7F);
+}
+
+static boolean is_solid_for_player(type t)
+{
+    return (boolean)(block_props[t] & SOLID_FOR_PLAYER);
+}
+
+static boolean above_block_non_solid(miner_state* s, int x, int y)
+{
+    if(PLAYER_INT(s, PLAYER_Y) > 0) {
+        return (is_solid_for_player(get_block_type(s, x, y))
+                && !is_solid_for_player(get_block_type(s, x, y - 1)));
+    }
+    return False;
+}
+
+static pickaxe* get_pickaxe_data(type t)
+{
+    return &pickaxe_data[t];
+}
+
+static void schedule_rock(miner_state* s, int x, int y, int ticks)
+{
+    rock_slot* slot = &s->falling_rocks[(s->rock_tick + ticks) % FALL_WHEEL_SIZE];
+    if(slot->count == slot->capacity) {
+        int capacity = (slot->capacity > 0) ? slot->capacity * 2 : 16;
+        int (*rocks)[2] = realloc(slot->rocks, capacity * sizeof(*rocks));
+        if(rocks == NULL) {
+            fprintf(stderr, "Error: Out of memory\n");
+            exit(-1);
+        }
+        slot->rocks = rocks;
+        slot->capacity = capacity;
+    }
+    slot->rocks[slot->count][0] = x;
+    slot->rocks[slot->count][1] = y;
+    slot->count++;
+}
+
+static void set_falling_rock(miner_state* s, int x, int y, int ticks)
+{
+    put_block(s, x, y, FALLING_ROCK);
+    reveal(s, x, y);
+    schedule_rock(s, x, y, ticks);
+}
+
+static int count_falling_rocks(miner_state* s)
+{
+    int count = 0;
+    for(int i = 0; i < FALL_WHEEL_SIZE; i++) count += s->falling_rocks[i].count;
+    return count;
+}
+
+static void clear_falling_rocks(miner_state* s)
+{
+    for(int i = 0; i < FALL_WHEEL_SIZE; i++) s->falling_rocks[i].count = 0;
+    s->rock_tick = 0;
+}
+
+static void free_falling_rocks(miner_state* s)
+{
+    for(int i = 0; i < FALL_WHEEL_SIZE; i++) free(s->falling_rocks[i].rocks);
+    memset(s->falling_rocks, 0, sizeof(s->falling_rocks));
+    s->rock_tick = 0;
+}
+
+#define CHUNK_RW_COUNT ((size_t)(CHUNK_SIZE * CHUNK_SIZE))
+
+#define SAVE_MAGIC "MINR"
+#define SAVE_VERSION 11
+
+#define MAPPED_SAVE_ALIGN 4096
+
+/*
+ * Saves are written to a temporary file, synced and renamed over the save so
+ * a crash never leaves a half written one behind.
+ * Saves start with a header so a save from a build with a different player
+ * layout is rejected instead of read into the wrong fields, every chunk is
+ * stored as runs of identical blocks since most of the mine is plain dirt.
+ * Delta saves only store the chunks the player changed and mark the cells
+ * that still match the generated terrain with KEEP_GENERATED runs. Mapped
+ * saves store an index of chunk positions and then every chunk raw starting
+ * at a page boundary so the loader can map the file and use them in place
+ */
+#define KEEP_GENERATED NONE
+
+typedef struct {
+    char magic[4];
+    int version;
+    int format;
+    int generator_version;
+    int player_ints;
+    int player_types;
+    unsigned int seed;
+    unsigned int steps;
+    int chunk_count;
+    int data_offset;
+    unsigned long long mine_hash;
+    unsigned long long player_hash;
+} save_header;
+
+typedef struct {
+    unsigned short length;
+    block b;
+} block_run;
+
+typedef struct {
+    int cx;
+    int cy;
+    int run_count;
+} chunk_header;
+
+static boolean same_block(block* a, block* b)
+{
+    return (boolean)(a->block_type == b->block_type && a->health == b->health);
+}
+
+/* Chunks that are the same as the generated one are skipped when base is given */
+static boolean write_chunk(miner_state* s, FILE* f, chunk_entry* e, chunk* base, int* written)
+{
+    block_run runs[CHUNK_RW_COUNT];
+    block keep = {KEEP_GENERATED, 0};
+    chunk_header h;
+    h.cx = e->cx;
+    h.cy = e->cy;
+    h.run_count = 0;
+    for(size_t i = 0; i < CHUNK_RW_COUNT; i++) {
+        int x = e->cx * CHUNK_SIZE + (int)(i & CHUNK_MASK);
+        int y = e->cy * CHUNK_SIZE + (int)(i >> CHUNK_SHIFT);
+        block cell = chunk_block(s, e->c, x, y);
+        block base_cell;
+        block* b = &cell;
+        block_run* r;
+        if(base != NULL) {
+            base_cell = chunk_block(NULL, base, x, y);
+            if(same_block(&cell, &base_cell)) b = &keep;
+        }
+        if(h.run_count > 0 && same_block(&runs[h.run_count - 1].b, b)) {
+            runs[h.run_count - 1].length++;
+            continue;
+        }
+        r = &runs[h.run_count++];
+        r->length = 1;
+        r->b = *b;
+    }
+    if(h.run_count == 1 && runs[0].b.block_type == KEEP_GENERATED) return True;
+    (*written)++;
+    return fwrite(&h, sizeof(chunk_header), 1, f) == 1
+           && fwrite(runs, sizeof(block_run), h.run_count, f) == (size_t)h.run_count;
+}
+
+static boolean read_chunk(miner_state* s, FILE* f, type format)
+{
+    block_run runs[CHUNK_RW_COUNT];
+    chunk* c;
+    chunk_header h;
+    size_t filled = 0;
+    if(fread(&h, sizeof(chunk_header), 1, f) != 1) return False;
+    if(h.run_count <= 0 || (size_t)h.run_count > CHUNK_RW_COUNT) return False;
+    if(h.cx < INT_MIN / CHUNK_SIZE || h.cx > INT_MAX / CHUNK_SIZE) return False;
+    if(h.cy < INT_MIN / CHUNK_SIZE || h.cy > INT_MAX / CHUNK_SIZE) return False;
+    if(fread(runs, sizeof(block_run), h.run_count, f) != (size_t)h.run_count) return False;
+    c = insert_chunk(s, h.cx, h.cy);
+    if(format == DELTA_SAVE) generate_chunk(s, h.cx, h.cy, c);
+    for(int i = 0; i < h.run_count; i++) {
+        if(filled + runs[i].length > CHUNK_RW_COUNT) return False;
+        if(runs[i].b.block_type == KEEP_GENERATED) {
+            if(format != DELTA_SAVE) return False;
+            filled += runs[i].length;
+            continue;
+        }
+        if((runs[i].b.block_type & ~VISIBLE) >= TOTAL_BLOCKS) return False;
+        for(int j = 0; j < runs[i].length; j++, filled++) {
+            set_chunk_block(s, c, h.cx * CHUNK_SIZE + (int)(filled & CHUNK_MASK), h.cy * CHUNK_SIZE + (int)(filled >> CHUNK_SHIFT), runs[i].b);
+        }
+    }
+    if(filled != CHUNK_RW_COUNT) return False;
+    mark_chunk(c);
+    return True;
+}
+
+/* Mapped chunks have no health plane so the health map is stored with them */
+static boolean write_healths(miner_state* s, FILE* f)
+{
+    if(fwrite(&s->healths.count, sizeof(int), 1, f) != 1) return False;
+    for(int i = 0; i < s->healths.capacity; i++) {
+        health_entry* e = &s->healths.entries[i];
+        int cell[3] = {e->x, e->y, e->health};
+        if(e->used && fwrite(cell, sizeof(int), 3, f) != 3) return False;
+    }
+    return True;
+}
+
+static boolean read_healths(miner_state* s, FILE* f)
+{
+    int count;
+    if(fread(&count, sizeof(int), 1, f) != 1 || count < 0) return False;
+    for(int i = 0; i < count; i++) {
+        int cell[3];
+        if(fread(cell, sizeof(int), 3, f) != 3) return False;
+        insert_health(&s->healths, cell[0], cell[1], (char)cell[2]);
+    }
+    return True;
+}
+
+static boolean write_mapped_chunks(miner_state* s, FILE* f, save_header* h)
+{
+    static const char padding[MAPPED_SAVE_ALIGN];
+    long index_end;
+    for(int i = 0; i < s->chunks.capacity; i++) {
+        chunk_entry* e = &s->chunks.entries[i];
+        if(e->c == NULL) continue;
+        if(fwrite(&e->cx, sizeof(int), 1, f) != 1 || fwrite(&e->cy, sizeof(int), 1, f) != 1) return False;
+        h->chunk_count++;
+    }
+    index_end = ftell(f);
+    if(index_end < 0) return False;
+    h->data_offset = (int)((index_end + MAPPED_SAVE_ALIGN - 1) / MAPPED_SAVE_ALIGN * MAPPED_SAVE_ALIGN);
+    if(fwrite(padding, 1, h->data_offset - index_end, f) != (size_t)(h->data_offset - index_end)) return False;
+    for(int i = 0; i < s->chunks.capacity; i++) {
+        chunk_entry* e = &s->chunks.entries[i];
+        if(e->c == NULL) continue;
+        if(fwrite(e->c, sizeof(chunk), 1, f) != 1) return False;
+    }
+    return True;
+}
+
+/*
+ * The mapping is private so changes to the chunks stay in memory until the
+ * next save, which writes a new file instead of touching the mapped one
+ */
+static boolean load_mapped_chunks(miner_state* s, FILE* f, save_header* h)
+{
+    struct stat st;
+    char* data;
+    char* index;
+    size_t size;
+    long index_start = ftell(f);
+    if(index_start < 0 || h->data_offset % MAPPED_SAVE_ALIGN != 0 || fstat(fileno(f), &st) != 0) return False;
+    size = (size_t)st.st_size;
+    if(h->chunk_count < 0 || index_start + 2 * sizeof(int) * h->chunk_count > (size_t)h->data_offset
+       || (size_t)h->data_offset + h->chunk_count * sizeof(chunk) > size) return False;
+    data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(f), 0);
+    if(data == MAP_FAILED) return False;
+    s->mapped_save = data;
+    s->mapped_save_size = size;
+    index = data + index_start;
+    for(int i = 0; i < h->chunk_count; i++) {
+        int pos[2];
+        chunk_entry* e;
+        memcpy(pos, index + i * sizeof(pos), sizeof(pos));
+        e = claim_entry(s, pos[0], pos[1]);
+        if(e->c != NULL) return False;
+        e->c = (chunk*)(data + h->data_offset) + i;
+    }
+    return True;
+}
+
+/* Menus, notices and the last rescue, so a loaded game picks up mid notice */
+static boolean write_session(miner_state* s, FILE* f)
+{
+    type types[] = {s->selected_menu_action, s->selected_shop_action, s->menu, s->shop,
+                    s->notice, s->rescue_reason, s->rescue_block};
+    int ints[] = {s->rescue_x, s->rescue_y, s->rescue_scr_x, s->rescue_scr_y,
+                  s->rescue_camera_x, s->rescue_camera_y, s->rescue_price, s->ore_sold_for};
+    return fwrite(types, sizeof(types), 1, f) == 1 && fwrite(ints, sizeof(ints), 1, f) == 1;
+}
+
+static boolean read_session(miner_state* s, FILE* f)
+{
+    type types[7];
+    int ints[8];
+    if(fread(types, sizeof(types), 1, f) != 1 || fread(ints, sizeof(ints), 1, f) != 1) return False;
+    s->selected_menu_action = types[0];
+    s->selected_shop_action = types[1];
+    s->menu = types[2];
+    s->shop = types[3];
+    s->notice = types[4];
+    s->rescue_reason = types[5];
+    s->rescue_block = types[6];
+    s->rescue_x = ints[0];
+    s->rescue_y = ints[1];
+    s->rescue_scr_x = ints[2];
+    s->rescue_scr_y = ints[3];
+    s->rescue_camera_x = ints[4];
+    s->rescue_camera_y = ints[5];
+    s->rescue_price = ints[6];
+    s->ore_sold_for = ints[7];
+    return True;
+}
+
+/* Every falling rock is stored with the ticks left before it drops */
+static boolean write_falling_rocks(miner_state* s, FILE* f)
+{
+    int count = count_falling_rocks(s);
+    if(fwrite(&count, sizeof(int), 1, f) != 1) return False;
+    for(int ticks = 1; ticks < FALL_WHEEL_SIZE; ticks++) {
+        rock_slot* slot = &s->falling_rocks[(s->rock_tick + ticks) % FALL_WHEEL_SIZE];
+        for(int i = 0; i < slot->count; i++) {
+            int rock[3] = {slot->rocks[i][0], slot->rocks[i][1], ticks};
+            if(fwrite(rock, sizeof(int), 3, f) != 3) return False;
+        }
+    }
+    return True;
+}
+
+static boolean read_falling_rocks(miner_state* s, FILE* f)
+{
+    int count;
+    clear_falling_rocks(s);
+    if(fread(&count, sizeof(int), 1, f) != 1 || count < 0) return False;
+    for(int i = 0; i < count; i++) {
+        int rock[3];
+        if(fread(rock, sizeof(int), 3, f) != 3 || rock[2] < 1 || rock[2] >= FALL_WHEEL_SIZE) return False;
+        schedule_rock(s, rock[0], rock[1], rock[2]);
+    }
+    return True;
+}
+
+/* The header is written again at the end once the chunk count is known */
+static boolean write_save(miner_state* s, FILE* f, type format)
+{
+    save_header h;
+    chunk base;
+    long start = ftell(f);
+    if(start < 0) return False;
+    memset(&h, 0, sizeof(save_header));
+    memcpy(h.magic, SAVE_MAGIC, sizeof(h.magic));
+    h.version = SAVE_VERSION;
+    h.format = format;
+    h.generator_version = GENERATOR_VERSION;
+    h.player_ints = TOTAL_PLAYER_INTS;
+    h.player_types = TOTAL_PLAYER_TYPES;
+    h.seed = s->seed;
+    h.steps = s->steps;
+    h.mine_hash = s->mine_hash;
+    h.player_hash = s->player_hash;
+    if(fwrite(&h, sizeof(save_header), 1, f) != 1) return False;
+    for(int i = 0; i < TOTAL_PLAYER_INTS; i++) {
+        if(fwrite(&PLAYER_INT(s, i), sizeof(int), 1, f) != 1) return False;
+    }
+    for(int i = 0; i < TOTAL_PLAYER_TYPES; i++) {
+        if(fwrite(&PLAYER_TYPE(s, i), sizeof(type), 1, f) != 1) return False;
+    }
+    if(!write_falling_rocks(s, f)) return False;
+    if(!write_session(s, f)) return False;
+    if(format == MAPPED_SAVE) {
+        if(!write_healths(s, f) || !write_mapped_chunks(s, f, &h)) return False;
+    } else {
+        for(int i = 0; i < s->chunks.capacity; i++) {
+            chunk_entry* e = &s->chunks.entries[i];
+            if(e->c == NULL) continue;
+            if(format == DELTA_SAVE) generate_chunk(s, e->cx, e->cy, &base);
+            if(!write_chunk(s, f, e, (format == DELTA_SAVE) ? &base : NULL, &h.chunk_count)) return False;
+        }
+    }
+    return fseek(f, start, SEEK_SET) == 0
+           && fwrite(&h, sizeof(save_header), 1, f) == 1
+           && fseek(f, 0, SEEK_END) == 0;
+}
+
+static boolean decode_save(miner_state* s, FILE* f)
+{
+    save_header h;
+    if(fread(&h, sizeof(save_header), 1, f) != 1
+       || memcmp(h.magic, SAVE_MAGIC, sizeof(h.magic)) != 0
+       || h.version != SAVE_VERSION
+       || h.format < FULL_SAVE || h.format >= TOTAL_SAVE_FORMATS
+       || (h.format == DELTA_SAVE && h.generator_version != GENERATOR_VERSION)
+       || h.player_ints != TOTAL_PLAYER_INTS
+       || h.player_types != TOTAL_PLAYER_TYPES) return False;
+    for(int i = 0; i < TOTAL_PLAYER_INTS; i++) {
+        if(fread(&PLAYER_INT(s, i), sizeof(int), 1, f) != 1) return False;
+    }
+    for(int i = 0; i < TOTAL_PLAYER_TYPES; i++) {
+        if(fread(&PLAYER_TYPE(s, i), sizeof(type), 1, f) != 1) return False;
+    }
+    if(!read_falling_rocks(s, f)) return False;
+    if(!read_session(s, f)) return False;
+    s->seed = h.seed;
+    s->steps = h.steps;
+    s->mine_hash = h.mine_hash;
+    s->player_hash = h.player_hash;
+    s->save_format = h.format;
+    free_chunks(s);
+    if(h.format == MAPPED_SAVE) return read_healths(s, f) && load_mapped_chunks(s, f, &h);
+    for(int i = 0; i < h.chunk_count; i++) {
+        if(!read_chunk(s, f, h.format)) return False;
+    }
+    return True;
+}
+
+/*
+ * A save that fails to load partway has already overwritten the player and
+ * some of the chunks, so the state is started over instead of left half
+ * loaded
+ */
+static boolean read_save(miner_state* s, FILE* f)
+{
+    if(decode_save(s, f)) return True;
+    miner_init(s);
+    return False;
+}
+
+boolean miner_save(miner_state* s, const char* fn, type format)
+{
+    char tmp[FILENAME_MAX];
+    FILE* f;
+    if(snprintf(tmp, sizeof(tmp), "%s.tmp", fn) >= (int)sizeof(tmp)) return False;
+    f = fopen(tmp, "wb");
+    if(f == NULL) return False;
+    if(!write_save(s, f, format) || fflush(f) == EOF || fsync(fileno(f)) != 0) {
+        fclose(f);
+        return False;
+    }
+    if(fclose(f) == EOF) return False;
+    return (boolean)(rename(tmp, fn) == 0);
+}
+
+boolean miner_load(miner_state* s, const char* fn)
+{
+    boolean loaded;
+    FILE* f = fopen(fn, "rb");
+    if(f == NULL) return False;
+    loaded = read_save(s, f);
+    if(fclose(f) == EOF) return False;
+    return loaded;
+}
+
+/* Mapped saves need a file of their own */
+boolean miner_save_stream(miner_state* s, FILE* f, type format)
+{
+    if(format == MAPPED_SAVE) return False;
+    return write_save(s, f, format);
+}
+
+boolean miner_load_stream(miner_state* s, FILE* f)
+{
+    return read_save(s, f) && s->save_format != MAPPED_SAVE;
+}
+
+/*
+ * Most cells are inside their chunk with all their neighbours, one lookup
+ * and three rows of the visibility bits do
+ */
+static void reveal(miner_state* s, int x, int y)
+{
+    int xdir, ydir, x_offset, y_offset;
+    int lx = x & CHUNK_MASK, ly = y & CHUNK_MASK;
+    if(x > 1 && y > 1 && lx > 0 && lx < CHUNK_MASK && ly > 0 && ly < CHUNK_MASK) {
+        chunk* c = cell_chunk(s, x, y);
+        for(int row = ly - 1; row <= ly + 1; row++) {
+            unsigned int hidden = ~c->visible[row] & (7u << (lx - 1));
+            while(hidden != 0) {
+                int hx = lowest_bit(hidden);
+                hidden &= hidden - 1;
+                show_cell(s, c, x - lx + hx, y - ly + row);
+            }
+        }
+        return;
+    }
+    for(int i = 0; i < 9; i++) {
+        xdir = dirs[i][0];
+        ydir = dirs[i][1];
+        x_offset = (x + xdir > 0) ? x + xdir : 0;
+        y_offset = (y + ydir > 0) ? y + ydir : 0;
+        if(!(x_offset == 0 && y_offset == 0)) show_block(s, x_offset, y_offset);
+    }
+}
+
+static void generate_chunk(miner_state* s, int cx, int cy, chunk* c)
+{
+    for(int ly = 0; ly < CHUNK_SIZE; ly++) {
+        generate_row(s->seed, cx * CHUNK_SIZE, cy * CHUNK_SIZE + ly, CHUNK_SIZE, c->types[ly]);
+        c->visible[ly] = 0;
+    }
+    mark_chunk(c);
+}
+
+static boolean build_structure(miner_state* s, type structure, type direction)
+{
+    int x_offset = PLAYER_INT(s, PLAYER_X);
+    int y_offset = PLAYER_INT(s, PLAYER_Y);
+    type st = structure;
+    move_dir(direction, &x_offset, &y_offset);
+    if(get_block_type(s, x_offset, y_offset) == AIR) {
+        switch(structure) {
+        case SUPPORT:
+            if(get_block_type(s, x_offset, y_offset + 1) != AIR
+               && PLAYER_INT(s, INV_SUPPORTS) > 0) {
+                add_player_int(s, INV_SUPPORTS, -1);
+                add_player_int(s, SUPPORTS_PLACED, 1);
+            } else st = NONE;
+            break;
+        case LADDER:
+            if(PLAYER_INT(s, INV_LADDERS) > 0) {
+                add_player_int(s, INV_LADDERS, -1);
+                add_player_int(s, LADDERS_PLACED, 1);
+            } else st = NONE;
+            break;
+        default:
+            break;
+        }
+        if(st != NONE) {
+            add_player_int(s, STRUCTURES_PLACED, 1);
+            put_block(s, x_offset, y_offset, st);
+            reveal(s, x_offset, y_offset);
+            return True;
+        }
+    }
+    return False;
+}
+
+/* Turns the ladders in column x from top to bottom into air */
+static void clear_ladders(miner_state* s, int x, int top, int bottom)
+{
+    int lx = x & CHUNK_MASK;
+    for(int y = top; y <= bottom; y = (y | CHUNK_MASK) + 1) {
+        chunk* c = get_chunk(s, x >> CHUNK_SHIFT, y >> CHUNK_SHIFT);
+        unsigned int cells = c->stops_player[lx] & (~0u << (y & CHUNK_MASK));
+        if((y | CHUNK_MASK) >= bottom) cells &= ~0u >> (CHUNK_MASK - (bottom & CHUNK_MASK));
+        while(cells != 0) {
+            int ly = lowest_bit(cells);
+            cells &= cells - 1;
+            if(c->types[ly][lx] == LADDER) put_visible_block(s, x, (y & ~CHUNK_MASK) + ly, AIR);
+        }
+    }
+}
+
+/*
+ * Only ladders and air let a rock through so the rock lands right above the
+ * next cell that stops it, unless the player is in the way
+ */
+static void drop_rock(miner_state* s, int x, int y, int landing)
+{
+    boolean crushed = False;
+    int player_y = PLAYER_INT(s, PLAYER_Y);
+    if(x == PLAYER_INT(s, PLAYER_X) && player_y > y && player_y <= landing && PLAYER_INT(s, INV_SUPPORTS) > 0) {
+        clear_ladders(s, x, y + 1, player_y);
+        build_structure(s, SUPPORT, NO_DIRECTION);
+        landing = player_y - 1;
+    } else {
+        crushed = (boolean)(x == PLAYER_INT(s, PLAYER_X) && player_y > y && player_y <= landing);
+        clear_ladders(s, x, y + 1, landing);
+    }
+    put_visible_block(s, x, y, AIR);
+    if(crushed) {
+        int orig_player_x = PLAYER_INT(s, PLAYER_X);
+        int orig_player_y = PLAYER_INT(s, PLAYER_Y);
+        put_visible_block(s, orig_player_x, orig_player_y, ROCK);
+        return_to_surface(s, CRUSHED_BY_ROCK);
+        put_visible_block(s, orig_player_x, orig_player_y, AIR);
+    }
+    put_block(s, x, landing, ROCK);
+    reveal(s, x, landing);
+}
+
+/* A rock leaving its cell knocks the rock or the supports above it loose */
+static void fall_rock(miner_state* s, int x, int y)
+{
+    type above = get_block_type(s, x, y - 1);
+    if(above == ROCK) set_falling_rock(s, x, y - 1, rock_fall_ticks - 1);
+    else if(above == SUPPORT) collapse_supports(s, x, y - 1);
+    drop_rock(s, x, y, next_stop(s, x, y, True) - 1);
+}
+
+/* The cells out of the given bits of a chunk row that are of type t */
+typedef unsigned int (*row_match)(const type* row, type t, unsigned int cells);
+
+static unsigned int scalar_match(const type* row, type t, unsigned int cells)
+{
+    unsigned int matches = 0;
+    while(cells != 0) {
+        int lx = lowest_bit(cells);
+        cells &= cells - 1;
+        if(row[lx] == t) matches |= 1u << lx;
+    }
+    return matches;
+}
+
+#if defined FALL_SIMD
+
+/* The whole row is compared at once and the bytes packed into a mask */
+__attribute__((target("avx2")))
+static unsigned int avx2_match(const type* row, type t, unsigned int cells)
+{
+    __m256i cell_types = _mm256_loadu_si256((const __m256i*)row);
+    return cells & (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(cell_types, _mm256_set1_epi8((char)t)));
+}
+
+static const row_match row_matches[TOTAL_FALL_KERNELS] = {
+    NULL,
+    scalar_match,
+    avx2_match
+};
+
+#else
+
+static const row_match row_matches[TOTAL_FALL_KERNELS] = {
+    NULL,
+    scalar_match,
+    NULL
+};
+
+#endif
+
+static const char* fall_kernel_names[TOTAL_FALL_KERNELS] = {
+    "rock",
+    "row",
+    "avx2 row"
+};
+
+static type fall_kernel = ROCK_FALLS;
+static pthread_once_t fall_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Drops a run of rocks from one row of a chunk in the order they were
+ * scheduled, the way fall_rock() does. The row and the row above it are
+ * read into masks up front, that holds for the whole run since a rock only
+ * changes cells in its own column, the player included
+ */
+static void fall_row(miner_state* s, int (*rocks)[2], int count, row_match match)
+{
+    int y = rocks[0][1], ly = y & CHUNK_MASK;
+    chunk* c = cell_chunk(s, rocks[0][0], y);
+    chunk* up = cell_chunk(s, rocks[0][0], y - 1);
+    const type* above = up->types[(y - 1) & CHUNK_MASK];
+    unsigned int due = 0, above_rocks, above_supports;
+    for(int i = 0; i < count; i++) due |= 1u << (rocks[i][0] & CHUNK_MASK);
+    due = match(c->types[ly], FALLING_ROCK, due);
+    above_rocks = match(above, ROCK, due);
+    above_supports = match(above, SUPPORT, due);
+    for(int i = 0; i < count; i++) {
+        int x = rocks[i][0], lx = x & CHUNK_MASK;
+        unsigned int bit = 1u << lx, below;
+        if(!(due & bit)) continue;
+        due &= ~bit;
+        if(above_rocks & bit) set_falling_rock(s, x, y - 1, rock_fall_ticks - 1);
+        else if(above_supports & bit) collapse_supports(s, x, y - 1);
+        below = c->stops_rocks[lx] & (~0u << ly << 1);
+        drop_rock(s, x, y, (below != 0) ? y - ly + lowest_bit(below) - 1 : next_stop(s, x, y, True) - 1);
+    }
+}
+
+/*
+ * Rocks are never scheduled for the tick being run so the slot does not
+ * change under the loop, a rock whose cell was replaced is dropped. The row
+ * kernels take rocks scheduled one after another in the same row of a chunk
+ * together, a cave-in schedules them that way
+ */
+static void fall_rocks(miner_state* s)
+{
+    rock_slot* slot = &s->falling_rocks[++s->rock_tick % FALL_WHEEL_SIZE];
+    row_match match = row_matches[fall_kernel];
+    if(match == NULL) {
+        for(int i = 0; i < slot->count; i++) {
+            int fr_x = slot->rocks[i][0];
+            int fr_y = slot->rocks[i][1];
+            if(get_block_type(s, fr_x, fr_y) == FALLING_ROCK) fall_rock(s, fr_x, fr_y);
+        }
+    } else {
+        for(int i = 0, run; i < slot->count; i += run) {
+            int x = slot->rocks[i][0], y = slot->rocks[i][1];
+            for(run = 1; i + run < slot->count; run++) {
+                if(slot->rocks[i + run][1] != y || ((slot->rocks[i + run][0] ^ x) & ~CHUNK_MASK)) break;
+            }
+            fall_row(s, slot->rocks + i, run, match);
+        }
+    }
+    slot->count = 0;
+}
+
+boolean miner_fall_kernel_supported(type kernel)
+{
+    if(kernel >= TOTAL_FALL_KERNELS) return False;
+    if(kernel == ROCK_FALLS) return True;
+    if(row_matches[kernel] == NULL) return False;
+#if defined FALL_SIMD
+    if(kernel == AVX2_ROW_FALLS) return __builtin_cpu_supports("avx2") ? True : False;
+#endif
+    return True;
+}
+
+static void init_fall_kernel()
+{
+    type kernel = AVX2_ROW_FALLS;
+    while(!miner_fall_kernel_supported(kernel)) kernel--;
+    fall_kernel = kernel;
+}
+
+void miner_use_fall_kernel(type kernel)
+{
+    pthread_once(&fall_once, init_fall_kernel);
+    if(miner_fall_kernel_supported(kernel)) fall_kernel = kernel;
+}
+
+type miner_fall_kernel()
+{
+    pthread_once(&fall_once, init_fall_kernel);
+    return fall_kernel;
+}
+
+const char* miner_fall_kernel_name(type kernel)
+{
+    return (kernel < TOTAL_FALL_KERNELS) ? fall_kernel_names[kernel] : "none";
+}
+
+static void collapse_supports(miner_state* s, int x, int y)
+{
+    while(get_block_type(s, x, y) == SUPPORT) {
+        put_visible_block(s, x, y, AIR);
+        if(get_block_type(s, x, --y) == ROCK) set_falling_rock(s, x, y, rock_fall_ticks);
+    }
+}
+
+static void deplete_stamina(miner_state* s, int amount)
+{
+    add_player_int(s, STAMINA, -amount);
+    if(PLAYER_INT(s, STAMINA) <= 0) {
+        if(!use_coffee(s)) return_to_surface(s, OUT_OF_STAMINA);
+    }
+}
+
+static boolean dig(miner_state* s, type direction)
+{
+    int x_offset = PLAYER_INT(s, PLAYER_X);
+    int y_offset = PLAYER_INT(s, PLAYER_Y);
+    switch(direction) {
+    case UP:
+        if(PLAYER_INT(s, PLAYER_Y) > 0) y_offset--;
+        break;
+    case DOWN:
+        y_offset++;
+        break;
+    case LEFT:
+        if(PLAYER_INT(s, PLAYER_X) > 0) x_offset--;
+        break;
+    case RIGHT:
+        x_offset++;
+        break;
+    case NO_DIRECTION:
+    default:
+        return False;
+    }
+    if(!(x_offset == PLAYER_INT(s, PLAYER_X) && y_offset == PLAYER_INT(s, PLAYER_Y))) {
+        type block_type = get_block_type(s, x_offset, y_offset);
+        char health = get_health(s, x_offset, y_offset, block_type);
+        type ore_type = get_ore_type(block_type);
+        if(!(ore_type != NOT_ORE && PLAYER_INT(s, INV_ORE) == PLAYER_INT(s, MAX_ORE))) {
+            if(block_type != AIR && PLAYER_TYPE(s, PLAYER_PICKAXE_TIER) >= get_minimum_tier(block_type) && health > -1) {
+                health = (char)(health - get_pickaxe_data(PLAYER_TYPE(s, PLAYER_PICKAXE_TIER))->damage);
+                set_health(s, x_offset, y_offset, health);
+                if(health <= 0) {
+                    add_player_int(s, TOTAL_BLOCKS_MINED, 1);
+                    if(ore_type != NOT_ORE) {
+                        add_player_int(s, TOTAL_ORE_MINED, 1);
+                        add_player_int(s, TOTAL_INDV_ORE_MINED + ore_type, 1);
+                        if(PLAYER_INT(s, INV_ORE) < PLAYER_INT(s, MAX_ORE)) {
+                            add_player_int(s, INV_ORE, 1);
+                            add_player_int(s, INV_INDV_ORE + ore_type, 1);
+                        }
+                        put_visible_block(s, x_offset, y_offset, DIRT);
+                    } else {
+                        put_block(s, x_offset, y_offset, AIR);
+                        reveal(s, x_offset, y_offset);
+                        if(y_offset - 1 > 0) {
+                            type upper_block = get_block_type(s, x_offset, y_offset - 1);
+                            if(upper_block == ROCK) set_falling_rock(s, x_offset, y_offset - 1, rock_fall_ticks);
+                            else if(upper_block == SUPPORT) collapse_supports(s, x_offset, y_offset - 1);
+                        }
+                    }
+                }
+                deplete_stamina(s, DIG_STAMINA_COST);
+                return True;
+            }
+        }
+    }
+    return False;
+}
+
+static void movecam(miner_state* s, type direction)
+{
+    int margin_x = s->camera_width / 4;
+    int margin_y = s->camera_height / 4;
+    switch(direction) {
+    case UP:
+        if(PLAYER_INT(s, PLAYER_SCR_Y) > margin_y) add_player_int(s, PLAYER_SCR_Y, -1);
+        else if(PLAYER_INT(s, CAMERA_Y) > 0) add_player_int(s, CAMERA_Y, -1);
+        else add_player_int(s, PLAYER_SCR_Y, -1);
+        break;
+    case DOWN:
+        if(PLAYER_INT(s, PLAYER_SCR_Y) < s->camera_height - margin_y) add_player_int(s, PLAYER_SCR_Y, 1);
+        else add_player_int(s, CAMERA_Y, 1);
+        break;
+    case RIGHT:
+        if(PLAYER_INT(s, PLAYER_SCR_X) < s->camera_width - margin_x) add_player_int(s, PLAYER_SCR_X, 1);
+        else add_player_int(s, CAMERA_X, 1);
+        break;
+    case LEFT:
+        if(PLAYER_INT(s, PLAYER_SCR_X) > margin_x) add_player_int(s, PLAYER_SCR_X, -1);
+        else if(PLAYER_INT(s, CAMERA_X) > 0) add_player_int(s, CAMERA_X, -1);
+        else add_player_int(s, PLAYER_SCR_X, -1);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Moves the player down distance cells, the camera follows like movecam() */
+static void drop_player(miner_state* s, int distance)
+{
+    int room = s->camera_height - s->camera_height / 4 - PLAYER_INT(s, PLAYER_SCR_Y);
+    int scr = (room < 0) ? 0 : (room < distance) ? room : distance;
+    add_player_int(s, PLAYER_Y, distance);
+    add_player_int(s, PLAYER_SCR_Y, scr);
+    add_player_int(s, CAMERA_Y, distance - scr);
+}
+
+/* Moves the camera the least it can to bring the player back inside the margins */
+static int fit_camera(int camera, int player, int size)
+{
+    int margin = size / 4;
+    if(player - camera > size - margin) camera = player - (size - margin);
+    else if(player - camera < margin && camera > 0) camera = player - margin;
+    return (camera < 0) ? 0 : camera;
+}
+
+static boolean move_player(miner_state* s, type direction, boolean forced)
+{
+    boolean moved = False;
+    int x_offset = PLAYER_INT(s, PLAYER_X);
+    int y_offset = PLAYER_INT(s, PLAYER_Y);
+    type player_b = get_block_type(s, PLAYER_INT(s, PLAYER_X), PLAYER_INT(s, PLAYER_Y));
+    type b;
+    switch(direction) {
+    case UP:
+        b = get_block_type(s, x_offset, y_offset - 1);
+        if(player_b == LADDER && !is_solid_for_player(b)) {
+            add_player_int(s, PLAYER_Y, -1);
+            movecam(s, UP);
+            moved = True;
+        }
+        break;
+    case DOWN:
+        b = get_block_type(s, x_offset, y_offset + 1);
+        if((!is_solid_for_player(b) && forced) || (b == LADDER && !forced)) {
+            add_player_int(s, PLAYER_Y, 1);
+            movecam(s, DOWN);
+            moved = True;
+        }
+        break;
+    case RIGHT:
+        b = get_block_type(s, x_offset+1, y_offset);
+        if(!is_solid_for_player(b)) {
+            add_player_int(s, PLAYER_X, 1);
+            movecam(s, RIGHT);
+            moved = True;
+        } else if(above_block_non_solid(s, x_offset + 1, y_offset) && PLAYER_INT(s, PLAYER_Y) > 0) {
+            add_player_int(s, PLAYER_X, 1);
+            add_player_int(s, PLAYER_Y, -1);
+            movecam(s, RIGHT);
+            movecam(s, UP);
+            moved = True;
+        }
+        break;
+    case LEFT:
+        b = get_block_type(s, x_offset-1, y_offset);
+        if(!is_solid_for_player(b)) {
+            add_player_int(s, PLAYER_X, -1);
+            movecam(s, LEFT);
+            moved = True;
+        } else if(above_block_non_solid(s, x_offset - 1, y_offset) && PLAYER_INT(s, PLAYER_Y) > 0) {
+            add_player_int(s, PLAYER_X, -1);
+            add_player_int(s, PLAYER_Y, -1);
+            movecam(s, LEFT);
+            movecam(s, UP);
+            moved = True;
+        }
+        break;
+    default:
+        break;
+    }
+    if(moved && !forced) deplete_stamina(s, MOVE_STAMINA_COST);
+    return moved;
+}
+
+static int sell_ores(miner_state* s)
+{
+    int amount = 0;
+    for(int i = 0; i < TOTAL_ORE; i++) {
+        amount += get_ore_price(i) * PLAYER_INT(s, INV_INDV_ORE + i);
+        set_player_int(s, INV_INDV_ORE + i, 0);
+    }
+    set_player_int(s, INV_ORE, 0);
+    add_player_int(s, MONEY, amount);
+    add_player_int(s, TOTAL_MONEY_EARNED, amount);
+    return amount;
+}
+
+static void return_to_surface(miner_state* s, type rescue_reason)
+{
+    s->rescue_reason = rescue_reason;
+    if(rescue_reason != NOT_RESCUED) {
+        s->rescued = True;
+        s->rescue_block = get_block_type(s, PLAYER_INT(s, PLAYER_X), PLAYER_INT(s, PLAYER_Y));
+        s->rescue_x = PLAYER_INT(s, PLAYER_X);
+        s->rescue_y = PLAYER_INT(s, PLAYER_Y);
+        s->rescue_scr_x = PLAYER_INT(s, PLAYER_SCR_X);
+        s->rescue_scr_y = PLAYER_INT(s, PLAYER_SCR_Y);
+        s->rescue_camera_x = PLAYER_INT(s, CAMERA_X);
+        s->rescue_camera_y = PLAYER_INT(s, CAMERA_Y);
+        s->rescue_price = PLAYER_INT(s, PLAYER_Y) * rescue_multiplier;
+        add_player_int(s, MONEY, -s->rescue_price);
+        add_player_int(s, TOTAL_MONEY_SPENT, s->rescue_price);
+        add_player_int(s, MONEY_SPENT_ON_RESCUES, s->rescue_price);
+        add_player_int(s, TIMES_RESCUED, 1);
+        switch(rescue_reason) {
+        case OUT_OF_STAMINA:
+            add_player_int(s, TIMES_OUT_OF_STAMINA, 1);
+            break;
+        case CRUSHED_BY_ROCK:
+            add_player_int(s, TIMES_CRUSHED_BY_ROCK, 1);
+            break;
+        case FALL:
+            add_player_int(s, TIMES_FALLEN, 1);
+            break;
+        case NOT_RESCUED:
+        default:
+            break;
+        }
+        s->notice = RESCUE_NOTICE;
+    } else s->notice = SURFACE_NOTICE;
+    set_player_int(s, STAMINA, max_stamina);
+    set_player_int(s, PLAYER_X, player_start_x);
+    set_player_int(s, PLAYER_Y, player_start_y);
+    set_player_int(s, PLAYER_SCR_X, player_start_x);
+    set_player_int(s, PLAYER_SCR_Y, player_start_y);
+    set_player_int(s, CAMERA_X, 0);
+    set_player_int(s, CAMERA_Y, 0);
+    s->ore_sold_for = (PLAYER_INT(s, INV_ORE) > 0) ? sell_ores(s) : 0;
+}
+
+static boolean use_coffee(miner_state* s)
+{
+    if(PLAYER_INT(s, INV_COFFEE) > 0) {
+        set_player_int(s, STAMINA, max_stamina);
+        add_player_int(s, INV_COFFEE, -1);
+        add_player_int(s, COFFEE_USED, 1);
+        return True;
+    }
+    return False;
+}
+
+static boolean use_dynamite(miner_state* s, type direction)
+{
+    if(PLAYER_INT(s, INV_DYNAMITE) > 0) {
+        int x_offset = PLAYER_INT(s, PLAYER_X);
+        int y_offset = PLAYER_INT(s, PLAYER_Y);
+        move_dir(direction, &x_offset, &y_offset);
+        if(get_block_type(s, x_offset, y_offset) == ROCK) {
+            add_player_int(s, INV_DYNAMITE, -1);
+            add_player_int(s, DYNAMITE_USED, 1);
+            add_player_int(s, TOTAL_BLOCKS_MINED, 1);
+            put_block(s, x_offset, y_offset, AIR);
+            reveal(s, x_offset, y_offset);
+            type upper_block = get_block_type(s, x_offset, y_offset - 1);
+            if(upper_block == ROCK) {
+                set_falling_rock(s, x_offset, y_offset - 1, rock_fall_ticks);
+            } else if(upper_block == SUPPORT) collapse_supports(s, x_offset, y_offset - 1);
+            return True;
+        }
+    }
+    return False;
+}
+
+
+static void game_update(miner_state* s, char ch)
+{
+    boolean update = False;
+    type dir = ctdir(ch);
+    switch(ch) {
+    case NO_OP_KEY:
+        update = True;
+        break;
+    case MOVE_UP:
+    case MOVE_LEFT:
+    case MOVE_DOWN:
+    case MOVE_RIGHT:
+        if(move_player(s, dir, False)) {
+            if(PLAYER_INT(s, PLAYER_X) == 1 && PLAYER_INT(s, PLAYER_Y) == 1) {
+                return_to_surface(s, NOT_RESCUED);
+            } else update = True;
+        } else if(PLAYER_TYPE(s, AUTODIG)) update = dig(s, dir);
+        break;
+    case ACTION_LEFT:
+    case ACTION_DOWN:
+    case ACTION_UP:
+    case ACTION_RIGHT:
+    case ACTION_CENTER:
+        switch(PLAYER_TYPE(s, PLAYER_ACTION)) {
+        case DIG:
+            update = dig(s, dir);
+            break;
+        case BUILD_SUPPORT:
+        case BUILD_LADDER:
+            update = build_structure(s, PLAYER_TYPE(s, PLAYER_SELECTED_STRUCTURE), dir);
+            break;
+        case USE_DYNAMITE:
+            update = use_dynamite(s, dir);
+        default:
+            break;
+        }
+        break;
+    case PLACE_LADDER_KEY:
+        set_player_type(s, PLAYER_ACTION, BUILD_LADDER);
+        set_player_type(s, PLAYER_SELECTED_STRUCTURE, LADDER);
+        break;
+    case PLACE_SUPPORT_KEY:
+        set_player_type(s, PLAYER_ACTION, BUILD_SUPPORT);
+        set_player_type(s, PLAYER_SELECTED_STRUCTURE, SUPPORT);
+        break;
+    case DIG_KEY:
+        set_player_type(s, PLAYER_ACTION, DIG);
+        break;
+    case AUTO_DIG_KEY:
+        set_player_type(s, AUTODIG, (!PLAYER_TYPE(s, AUTODIG)) ? True : False);
+        break;
+    case USE_DYNAMITE_KEY:
+        set_player_type(s, PLAYER_ACTION, USE_DYNAMITE);
+        break;
+    case QUIT_KEY:
+        s->game_running = False;
+        break;
+    default:
+        break;
+    }
+    if(update) {
+        int fall_distance = next_stop(s, PLAYER_INT(s, PLAYER_X), PLAYER_INT(s, PLAYER_Y), False) - 1 - PLAYER_INT(s, PLAYER_Y);
+        if(fall_distance > 0) drop_player(s, fall_distance);
+        if(fall_distance > max_fall_distance) return_to_surface(s, FALL);
+        fall_rocks(s);
+    }
+}
+
+static void buy_item(miner_state* s, type item, type max, type total, int price)
+{
+    if(PLAYER_INT(s, item) < PLAYER_INT(s, max) && PLAYER_INT(s, MONEY) >= price) {
+        add_player_int(s, item, 1);
+        add_player_int(s, total, 1);
+        add_player_int(s, MONEY, -price);
+        add_player_int(s, TOTAL_MONEY_SPENT, price);
+    }
+}
+
+static void game_menu(miner_state* s, char ch)
+{
+    if(!s->shop) {
+        switch(ch) {
+        case MENU_UP:
+            if(s->selected_menu_action > 0) s->selected_menu_action--;
+            break;
+        case MENU_DOWN:
+            if(s->selected_menu_action < TOTAL_MENU_ACTIONS - 1) s->selected_menu_action++;
+            break;
+        case MENU_SELECT:
+            switch(s->selected_menu_action) {
+            case RETURN_TO_MINE:
+                s->menu = False;
+                break;
+            case OPEN_SHOP:
+                s->shop = True;
+                break;
+            case VIEW_STATS:
+                s->notice = STATS_NOTICE;
+                break;
+            case EXIT_GAME:
+                s->game_running = False;
+                break;
+            default:
+                break;
+            }
+            break;
+        default:
+            break;
+        }
+    } else {
+        switch(ch) {
+        case MENU_UP:
+            if(s->selected_shop_action > 0) s->selected_shop_action--;
+            break;
+        case MENU_DOWN:
+            if(s->selected_shop_action < TOTAL_SHOP_ACTIONS - 1) s->selected_shop_action++;
+            break;
+        case MENU_SELECT:
+            switch(s->selected_shop_action) {
+            case UPGRADE_PICKAXE:
+                if(PLAYER_TYPE(s, PLAYER_PICKAXE_TIER) < max_pickaxe_tier) {
+                    pickaxe* next_p = get_pickaxe_data(PLAYER_TYPE(s, PLAYER_PICKAXE_TIER) + 1);
+                    if(PLAYER_INT(s, MONEY) >= next_p->price) {
+                        add_player_int(s, MONEY, -next_p->price);
+                        add_player_int(s, TOTAL_MONEY_SPENT, next_p->price);
+                        set_player_type(s, PLAYER_PICKAXE_TIER, PLAYER_TYPE(s, PLAYER_PICKAXE_TIER) + 1);
+                    }
+                }
+                break;
+            case UPGRADE_BAG:
+                if(PLAYER_TYPE(s, PLAYER_BAG_TIER) < max_bag_tier) {
+                    int next_bag_price = bag_prices[PLAYER_TYPE(s, PLAYER_BAG_TIER) + 1];
+                    if(PLAYER_INT(s, MONEY) >= next_bag_price) {
+                        add_player_int(s, MONEY, -next_bag_price);
+                        add_player_int(s, TOTAL_MONEY_SPENT, next_bag_price);
+                        set_player_type(s, PLAYER_BAG_TIER, PLAYER_TYPE(s, PLAYER_BAG_TIER) + 1);
+                        set_player_int(s, MAX_ORE, PLAYER_INT(s, MAX_ORE) * 2);
+                        set_player_int(s, MAX_SUPPORTS, PLAYER_INT(s, MAX_SUPPORTS) * 2);
+                        set_player_int(s, MAX_LADDERS, PLAYER_INT(s, MAX_LADDERS) * 2);
+                        set_player_int(s, MAX_COFFEE, PLAYER_INT(s, MAX_COFFEE) * 2);
+                        set_player_int(s, MAX_DYNAMITE, PLAYER_INT(s, MAX_DYNAMITE) * 2);
+                    }
+                }
+                break;
+            case BUY_COFFEE:
+                buy_item(s, INV_COFFEE, MAX_COFFEE, COFFEE_BOUGHT, COFFEE_PRICE);
+                break;
+            case BUY_DYNAMITE:
+                buy_item(s, INV_DYNAMITE, MAX_DYNAMITE, DYNAMITE_BOUGHT, DYNAMITE_PRICE);
+                break;
+            case BUY_SUPPORT:
+                buy_item(s, INV_SUPPORTS, MAX_SUPPORTS, SUPPORTS_BOUGHT, ITEM_SUPPORT_PRICE);
+                break;
+            case BUY_LADDER:
+                buy_item(s, INV_LADDERS, MAX_LADDERS, LADDERS_BOUGHT, ITEM_LADDER_PRICE);
+                break;
+            case BACK:
+                s->selected_shop_action = DEFAULT;
+                s->shop = False;
+                break;
+            default:
+                break;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static void dismiss_notice(miner_state* s, char ch)
+{
+    if(ch != MENU_SELECT) return;
+    switch(s->notice) {
+    case RESCUE_NOTICE:
+        s->notice = SURFACE_NOTICE;
+        break;
+    case SURFACE_NOTICE:
+        s->notice = NO_NOTICE;
+        s->menu = True;
+        break;
+    case STATS_NOTICE:
+    default:
+        s->notice = NO_NOTICE;
+        break;
+    }
+}
+
+void miner_step(miner_state* s, int key)
+{
+    char ch = (char)key;
+    s->steps++;
+    s->rescued = False;
+    if(s->notice != NO_NOTICE) dismiss_notice(s, ch);
+    else if(s->menu) game_menu(s, ch);
+    else game_update(s, ch);
+}
+
+static unsigned long long hash_player(miner_state* s)
+{
+    unsigned long long h = 0;
+    for(int i = 0; i < TOTAL_PLAYER_INTS; i++) h ^= field_key(i, PLAYER_INT(s, i));
+    for(int i = 0; i < TOTAL_PLAYER_TYPES; i++) h ^= field_key(PLAYER_TYPE_KEY(i), PLAYER_TYPE(s, i));
+    return h;
+}
+
+void miner_set_viewport(miner_state* s, int width, int height)
+{
+    int camera_x, camera_y;
+    s->camera_width = (width < MIN_CAMERA_SIZE) ? MIN_CAMERA_SIZE : width;
+    s->camera_height = (height < MIN_CAMERA_SIZE) ? MIN_CAMERA_SIZE : height;
+    camera_x = fit_camera(PLAYER_INT(s, CAMERA_X), PLAYER_INT(s, PLAYER_X), s->camera_width);
+    camera_y = fit_camera(PLAYER_INT(s, CAMERA_Y), PLAYER_INT(s, PLAYER_Y), s->camera_height);
+    set_player_int(s, CAMERA_X, camera_x);
+    set_player_int(s, CAMERA_Y, camera_y);
+    set_player_int(s, PLAYER_SCR_X, PLAYER_INT(s, PLAYER_X) - camera_x);
+    set_player_int(s, PLAYER_SCR_Y, PLAYER_INT(s, PLAYER_Y) - camera_y);
+}
+
+void miner_init(miner_state* s)
+{
+    miner_batch* b = s->batch;
+    int slot = s->slot;
+    free_chunks(s);
+    free_falling_rocks(s);
+    memset(s, 0, sizeof(miner_state));
+    s->batch = b;
+    s->slot = slot;
+    s->save_format = DELTA_SAVE;
+    s->camera_width = CAMERA_WIDTH;
+    s->camera_height = CAMERA_HEIGHT;
+    for(int i = 0; i < TOTAL_PLAYER_INTS; i++) PLAYER_INT(s, i) = 0;
+    for(int i = 0; i < TOTAL_PLAYER_TYPES; i++) PLAYER_TYPE(s, i) = DEFAULT;
+    PLAYER_INT(s, STAMINA) = max_stamina;
+    PLAYER_INT(s, MONEY) = starting_money;
+    PLAYER_TYPE(s, AUTODIG) = False;
+    PLAYER_INT(s, INV_LADDERS) = STARTING_LADDERS;
+    PLAYER_INT(s, INV_SUPPORTS) = STARTING_SUPPORTS;
+    PLAYER_INT(s, INV_COFFEE) = STARTING_COFFEE;
+    PLAYER_INT(s, INV_DYNAMITE) = STARTING_DYNAMITE;
+    PLAYER_INT(s, MAX_ORE) = STARTING_MAX_ORE;
+    PLAYER_INT(s, MAX_SUPPORTS) = STARTING_MAX_SUPPORTS;
+    PLAYER_INT(s, MAX_LADDERS) = STARTING_MAX_LADDERS;
+    PLAYER_INT(s, MAX_COFFEE) = STARTING_MAX_COFFEE;
+    PLAYER_INT(s, MAX_DYNAMITE) = STARTING_MAX_DYNAMITE;
+    PLAYER_INT(s, PLAYER_X) = player_start_x;
+    PLAYER_INT(s, PLAYER_Y) = player_start_y;
+    PLAYER_INT(s, PLAYER_SCR_X) = player_start_x;
+    PLAYER_INT(s, PLAYER_SCR_Y) = player_start_y;
+    s->selected_menu_action = DEFAULT;
+    s->selected_shop_action = DEFAULT;
+    s->game_running = True;
+    s->notice = NO_NOTICE;
+    s->rescue_reason = NOT_RESCUED;
+    s->player_hash = hash_player(s);
+}
+
+typedef struct {
+    miner_state* s;
+    chunk_entry* pending;
+    int band_width;
+    int bands;
+    int first_band;
+    int band_step;
+    boolean started;
+} generate_job;
+
+static void* generate_bands(void* arg)
+{
+    generate_job* job = arg;
+    for(int band = job->first_band; band < job->bands; band += job->band_step) {
+        for(int i = band * job->band_width; i < (band + 1) * job->band_width; i++) {
+            chunk_entry* e = &job->pending[i];
+            if(e->c != NULL) generate_chunk(job->s, e->cx, e->cy, e->c);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Chunks are inserted up front so the workers only ever write into chunks of
+ * their own bands, every block only depends on the seed and its position so
+ * the result is the same for any number of threads
+ */
+void miner_generate(miner_state* s, int width, int height, int threads)
+{
+    int band_width = (width + CHUNK_MASK) >> CHUNK_SHIFT;
+    int bands = (height + CHUNK_MASK) >> CHUNK_SHIFT;
+    chunk_entry* pending;
+    generate_job* jobs;
+    pthread_t* workers;
+    if(band_width <= 0 || bands <= 0) return;
+    if(threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(threads > bands) threads = bands;
+    if(threads < 1) threads = 1;
+    pending = calloc((size_t)band_width * bands, sizeof(chunk_entry));
+    jobs = calloc(threads, sizeof(generate_job));
+    workers = calloc(threads, sizeof(pthread_t));
+    if(pending == NULL || jobs == NULL || workers == NULL) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(-1);
+    }
+    if(s->chunks.capacity == 0) grow_chunk_map(&s->chunks);
+    for(int cy = 0; cy < bands; cy++) {
+        for(int cx = 0; cx < band_width; cx++) {
+            chunk_entry* e = &pending[cy * band_width + cx];
+            if(find_entry(&s->chunks, cx, cy)->c != NULL) continue;
+            e->cx = cx;
+            e->cy = cy;
+            e->c = insert_chunk(s, cx, cy);
+        }
+    }
+    generate_init();
+    for(int t = 0; t < threads; t++) {
+        jobs[t].s = s;
+        jobs[t].pending = pending;
+        jobs[t].band_width = band_width;
+        jobs[t].bands = bands;
+        jobs[t].first_band = t;
+        jobs[t].band_step = threads;
+        jobs[t].started = (t > 0 && pthread_create(&workers[t], NULL, generate_bands, &jobs[t]) == 0);
+    }
+    generate_bands(&jobs[0]);
+    for(int t = 1; t < threads; t++) {
+        if(jobs[t].started) pthread_join(workers[t], NULL);
+        else generate_bands(&jobs[t]);
+    }
+    free(workers);
+    free(jobs);
+    free(pending);
+}
+
+void miner_new_game(miner_state* s, unsigned int seed, int width, int height)
+{
+    miner_init(s);
+    s->seed = seed;
+    miner_generate(s, width, height, 0);
+    put_block(s, 1, 1, EXIT_SHAFT);
+    put_block(s, 1, 2, DIRT);
+    set_health(s, 1, 2, -1);
+    put_block(s, 2, 2, DIRT);
+    set_health(s, 2, 2, -1);
+    put_block(s, 2, 1, AIR);
+    put_block(s, 3, 1, AIR);
+    show_block(s, 0, 0);
+    for(int x = 1; x < 4; x++) {
+        reveal(s, x, 1);
+    }
+}
+
+miner_batch* miner_batch_new(int count)
+{
+    if(count < 1) return NULL;
+    generate_init();
+    pthread_once(&fall_once, init_fall_kernel);
+    miner_batch* b = calloc(1, sizeof(miner_batch));
+    int* ints = malloc(sizeof(int) * TOTAL_PLAYER_INTS * count);
+    type* types = malloc(sizeof(type) * TOTAL_PLAYER_TYPES * count);
+    miner_state* states = calloc(count, sizeof(miner_state));
+    if(b == NULL || ints == NULL || types == NULL || states == NULL) {
+        free(b);
+        free(ints);
+        free(types);
+        free(states);
+        return NULL;
+    }
+    b->count = count;
+    b->states = states;
+    for(int i = 0; i < TOTAL_PLAYER_INTS; i++) b->ints[i] = ints + i * count;
+    for(int i = 0; i < TOTAL_PLAYER_TYPES; i++) b->types[i] = types + i * count;
+    for(int i = 0; i < count; i++) {
+        states[i].batch = b;
+        states[i].slot = i;
+        miner_init(&states[i]);
+    }
+    return b;
+}
+
+void miner_batch_free(miner_batch* b)
+{
+    if(b == NULL) return;
+    free(b->ints[0]);
+    free(b->types[0]);
+    for(int i = 0; i < b->count; i++) {
+        free_chunks(&b->states[i]);
+        free_falling_rocks(&b->states[i]);
+    }
+    free(b->states);
+    free(b);
+}
+
+void miner_batch_new_games(miner_batch* b, const unsigned int* seeds)
+{
+    for(int i = 0; i < b->count; i++) miner_new_game(&b->states[i], seeds[i], 0, 0);
+}
+
+void miner_step_batch(miner_batch* b, const int* keys)
+{
+    for(int i = 0; i < b->count; i++) miner_step(&b->states[i], keys[i]);
+}
+
+unsigned long long miner_hash(miner_state* s)
+{
+    return s->mine_hash ^ s->player_hash;
+}
+
+unsigned long long miner_rehash(miner_state* s)
+{
+    unsigned long long h = hash_player(s);
+    chunk generated;
+    for(int i = 0; i < s->chunks.capacity; i++) {
+        chunk_entry* e = &s->chunks.entries[i];
+        if(e->c == NULL) continue;
+        generate_chunk(s, e->cx, e->cy, &generated);
+        for(int ly = 0; ly < CHUNK_SIZE; ly++) {
+            for(int lx = 0; lx < CHUNK_SIZE; lx++) {
+                int x = e->cx * CHUNK_SIZE + lx;
+                int y = e->cy * CHUNK_SIZE + ly;
+                block a = chunk_block(s, e->c, x, y);
+                block g = chunk_block(NULL, &generated, x, y);
+                if(!same_block(&a, &g)) h ^= cell_key(x, y, a.block_type, a.health) ^ cell_key(x, y, g.block_type, g.health);
+            }
+        }
+    }
+    return h;
+}
+
+block miner_get_block(miner_state* s, int x, int y)
+{
+    return chunk_block(s, cell_chunk(s, x, y), x, y);
+}
+
+void miner_put_block(miner_state* s, int x, int y, type block_type)
+{
+    if(block_type == FALLING_ROCK) set_falling_rock(s, x, y, rock_fall_ticks);
+    else if(block_type < TOTAL_BLOCKS) put_block(s, x, y, block_type);
+}
+
+type miner_block_type(miner_state* s, int x, int y)
+{
+    return get_block_type(s, x, y);
+}
+
+boolean miner_is_visible(miner_state* s, int x, int y)
+{
+    return is_visible(s, x, y);
+}
+
+char miner_symbol(type t)
+{
+    return get_symbol(t);
+}
+
+unsigned char miner_color(type t)
+{
+    return get_color(t);
+}
+
+const pickaxe* miner_pickaxe_data(type t)
+{
+    return get_pickaxe_data(t);
+}
+
+int miner_bag_price(type t)
+{
+    return bag_prices[t];
+}
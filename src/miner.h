@@ -0,0 +1,573 @@
+#ifndef MINER_H
+#define MINER_H
+
+#include "util.h"
+
+/* Viewport size until the front end sets one with miner_set_viewport() */
+#define CAMERA_WIDTH 32
+#define CAMERA_HEIGHT 32
+#define MIN_CAMERA_SIZE 8
+
+/*
+ * The mine has no fixed size, it is stored as CHUNK_SIZE * CHUNK_SIZE chunks
+ * that are generated the first time anything touches them
+ */
+#define CHUNK_SHIFT 5
+#define CHUNK_SIZE (1 << CHUNK_SHIFT)
+#define CHUNK_MASK (CHUNK_SIZE - 1)
+
+#define MOVE_UP 'w'
+#define MOVE_DOWN 's'
+#define MOVE_LEFT 'a'
+#define MOVE_RIGHT 'd'
+#define ACTION_UP 'k'
+#define ACTION_DOWN 'j'
+#define ACTION_LEFT 'h'
+#define ACTION_RIGHT 'l'
+#define ACTION_CENTER '.'
+
+#define NO_OP_KEY 'f'
+
+#define MENU_UP 'k'
+#define MENU_DOWN 'j'
+
+#define MENU_SELECT '\n'
+
+#define PLACE_LADDER_KEY 'z'
+#define PLACE_SUPPORT_KEY 'x'
+#define DIG_KEY 'c'
+
+#define AUTO_DIG_KEY 'o'
+
+#define USE_DYNAMITE_KEY 'v'
+
+#define QUIT_KEY 'q'
+
+#define VISIBLE ((type)128)
+
+typedef enum {
+    NO_DIRECTION = NONE,
+    UP = DEFAULT,
+    DOWN,
+    LEFT,
+    RIGHT
+} directions;
+
+typedef enum {
+    AIR = DEFAULT,
+    DIRT,
+    EXIT_SHAFT,
+    SUPPORT,
+    LADDER,
+    ROCK,
+    FALLING_ROCK,
+    COAL_BLOCK,
+    IRON_BLOCK,
+    COPPER_BLOCK,
+    SILVER_BLOCK,
+    GOLD_BLOCK,
+    PLATINUM_BLOCK,
+    TOTAL_BLOCKS
+} block_types;
+
+typedef enum {
+    AIR_MINIMUM_TIER = NONE,
+    DIRT_MINIMUM_TIER = DEFAULT,
+    ROCK_MINIMUM_TIER = NONE,
+    EXIT_SHAFT_MINIMUM_TIER = NONE,
+    SUPPORT_MINIMUM_TIER = NONE,
+    LADDER_MINIMUM_TIER = NONE,
+    COAL_MINIMUM_TIER = 0,
+    IRON_MINIMUM_TIER = 0,
+    COPPER_MINIMUM_TIER = 1,
+    SILVER_MINIMUM_TIER = 2,
+    GOLD_MINIMUM_TIER = 3,
+    PLATINUM_MINIMUM_TIER = 4
+} block_minimum_tiers;
+
+typedef enum {
+    AIR_HEALTH = -1,
+    DIRT_HEALTH = 10,
+    ROCK_HEALTH = -1,
+    EXIT_SHAFT_HEALTH = -1,
+    SUPPORT_HEALTH = -1,
+    LADDER_HEALTH = -1,
+    COAL_HEALTH = 20,
+    IRON_HEALTH = 30,
+    COPPER_HEALTH = 50,
+    SILVER_HEALTH = 75,
+    GOLD_HEALTH = 90,
+    PLATINUM_HEALTH = 120
+} block_healths;
+
+
+#if defined USING_WINDOWS
+
+typedef enum {
+    AIR_COLOR = 8,
+    DIRT_COLOR = 6,
+    ROCK_COLOR = 8,
+    EXIT_SHAFT_COLOR = 4,
+    COAL_COLOR = 8,
+    IRON_COLOR = 14,
+    COPPER_COLOR = 10,
+    SILVER_COLOR = 15,
+    GOLD_COLOR = 14,
+    PLATINUM_COLOR = 11,
+    LADDER_COLOR = 6,
+    SUPPORT_COLOR = 6
+} block_colors;
+
+#else
+
+typedef enum {
+    AIR_COLOR = 242,
+    DIRT_COLOR = 94,
+    ROCK_COLOR = 183,
+    EXIT_SHAFT_COLOR = 52,
+    COAL_COLOR = 16,
+    IRON_COLOR = 101,
+    COPPER_COLOR = 202,
+    SILVER_COLOR = 231,
+    GOLD_COLOR = 226,
+    PLATINUM_COLOR = 153,
+    LADDER_COLOR = 94,
+    SUPPORT_COLOR = 94
+} block_colors;
+
+#endif
+
+typedef enum {
+    NOT_ORE = NONE,
+    COAL = DEFAULT,
+    IRON,
+    COPPER,
+    SILVER,
+    GOLD,
+    PLATINUM,
+    TOTAL_ORE
+} ore_types;
+
+typedef enum {
+    COAL_PRICE = 32,
+    IRON_PRICE = 64,
+    COPPER_PRICE = 128,
+    SILVER_PRICE = 256,
+    GOLD_PRICE = 512,
+    PLATINUM_PRICE = 1024
+} ore_prices;
+
+typedef enum {
+    TIER1_BAG_PRICE = 2000,
+    TIER2_BAG_PRICE = 4000,
+    TIER3_BAG_PRICE = 8000,
+    TIER4_BAG_PRICE = 16000
+} bag_tier_prices;
+
+typedef enum {
+    ROCK_SPAWN_THRESHOLD = 1,
+    COAL_SPAWN_THRESHOLD = 1,
+    IRON_SPAWN_THRESHOLD = 1,
+    COPPER_SPAWN_THRESHOLD = 60,
+    SILVER_SPAWN_THRESHOLD = 160,
+    GOLD_SPAWN_THRESHOLD = 160,
+    PLATINUM_SPAWN_THRESHOLD = 384
+} block_spawn_thresholds;
+
+#define ROCK_CHANCE_MODIFIER 2
+
+typedef enum {
+    ROCK_CHANCE = 20,
+    COAL_CHANCE = 10,
+    IRON_CHANCE = 20,
+    COPPER_CHANCE = 30,
+    SILVER_CHANCE = 50,
+    GOLD_CHANCE = 100,
+    PLATINUM_CHANCE = 200
+} block_chances;
+
+typedef enum {
+    RETURN_TO_MINE = DEFAULT,
+    OPEN_SHOP,
+    VIEW_STATS,
+    EXIT_GAME,
+    TOTAL_MENU_ACTIONS
+} menu_actions;
+
+typedef enum {
+    UPGRADE_PICKAXE = DEFAULT,
+    UPGRADE_BAG,
+    BUY_COFFEE,
+    BUY_DYNAMITE,
+    BUY_SUPPORT,
+    BUY_LADDER,
+    BACK,
+    TOTAL_SHOP_ACTIONS
+} shop_actions;
+
+typedef enum {
+    TIER_1_PRICE = 4000,
+    TIER_2_PRICE = 8000,
+    TIER_3_PRICE = 16000,
+    TIER_4_PRICE = 32000,
+    TIER_5_PRICE = 64000,
+    TIER_6_PRICE = 128000
+} pickaxe_prices;
+
+typedef enum {
+    TIER_0_DAMAGE = 3,
+    TIER_1_DAMAGE = 4,
+    TIER_2_DAMAGE = 4,
+    TIER_3_DAMAGE = 4,
+    TIER_4_DAMAGE = 9,
+    TIER_5_DAMAGE = 9,
+    TIER_6_DAMAGE = 20
+} pickaxe_damages;
+
+typedef enum {
+    COFFEE = DEFAULT,
+    DYNAMITE,
+    ITEM_SUPPORT,
+    ITEM_LATTER
+} item_types;
+
+typedef enum {
+    COFFEE_PRICE = 60,
+    DYNAMITE_PRICE = 200,
+    ITEM_SUPPORT_PRICE = 25,
+    ITEM_LADDER_PRICE = 25
+} item_prices;
+
+typedef enum {
+    STARTING_MAX_ORE = 16,
+    STARTING_MAX_LADDERS = 16,
+    STARTING_MAX_SUPPORTS = 16,
+    STARTING_MAX_COFFEE = 4,
+    STARTING_MAX_DYNAMITE = 4
+} starting_max_items;
+
+typedef enum {
+    STARTING_COFFEE = 0,
+    STARTING_DYNAMITE = 0,
+    STARTING_SUPPORTS = 0,
+    STARTING_LADDERS = 0
+} starting_items;
+
+typedef enum {
+    MOVE_STAMINA_COST = 1,
+    DIG_STAMINA_COST = 5
+} action_stamina_costs;
+
+typedef enum {
+    NOT_RESCUED = NONE,
+    OUT_OF_STAMINA = DEFAULT,
+    CRUSHED_BY_ROCK,
+    FALL
+} rescue_reasons;
+
+typedef enum {
+    DIG = DEFAULT,
+    BUILD_SUPPORT,
+    BUILD_LADDER,
+    USE_DYNAMITE
+} player_actions;
+
+/*
+ * Screens that wait for the player to press MENU_SELECT before the
+ * simulation carries on, the front end decides how to present them
+ */
+typedef enum {
+    NO_NOTICE = NONE,
+    RESCUE_NOTICE = DEFAULT,
+    SURFACE_NOTICE,
+    STATS_NOTICE
+} notices;
+
+/*
+ * Delta saves only store what the player changed and regenerate the rest
+ * from the seed, so they only load with the same GENERATOR_VERSION. Mapped
+ * saves are larger but load by mapping the chunks straight from the file
+ */
+typedef enum {
+    FULL_SAVE = DEFAULT,
+    DELTA_SAVE,
+    MAPPED_SAVE,
+    TOTAL_SAVE_FORMATS
+} save_formats;
+
+typedef struct {
+    type tier;
+    char damage;
+    int price;
+} pickaxe;
+
+typedef struct {
+    type block_type;
+    char health;
+} block;
+
+/*
+ * Chunks hold the type of every cell in a byte plane and the rest in bit
+ * planes. Bit lx of visible[ly] is set once the cell was seen. Bit ly of
+ * column lx of the stop planes is set when that cell stops a falling player
+ * or a falling rock, so a fall skips the open cells a chunk at a time. Bit
+ * planes are one unsigned int per line so CHUNK_SIZE can be at most 32. Cell
+ * health is kept out of chunks in the health_map
+ */
+typedef struct {
+    type types[CHUNK_SIZE][CHUNK_SIZE];
+    unsigned int visible[CHUNK_SIZE];
+    unsigned int stops_player[CHUNK_SIZE];
+    unsigned int stops_rocks[CHUNK_SIZE];
+} chunk;
+
+typedef struct {
+    int cx;
+    int cy;
+    chunk* c;
+} chunk_entry;
+
+typedef struct {
+    chunk_entry* entries;
+    int capacity;
+    int count;
+} chunk_map;
+
+/*
+ * The chunks touched last, by position, so a rock falling through a column
+ * of chunks finds them all again without going through the chunk map
+ */
+#define RECENT_CHUNKS 16
+#define RECENT_CHUNK_SLOT(cx, cy) (((cx) & 1) | ((cy) & 7) << 1)
+
+/*
+ * Health of the cells that do not have the one they are generated with,
+ * mostly half dug blocks, so chunks do not spend a byte on it for every cell
+ */
+typedef struct {
+    int x;
+    int y;
+    char health;
+    boolean used;
+} health_entry;
+
+typedef struct {
+    health_entry* entries;
+    int capacity;
+    int count;
+} health_map;
+
+/* Falling rocks drop at most FALL_WHEEL_SIZE - 1 ticks after they start */
+#define FALL_WHEEL_SIZE 4
+
+typedef struct {
+    int (*rocks)[2];
+    int count;
+    int capacity;
+} rock_slot;
+
+/*
+ * How the rocks due in a tick are dropped: one at a time, or a chunk row at
+ * a time with the row read into bit masks by plain C or AVX2
+ */
+typedef enum {
+    ROCK_FALLS = DEFAULT,
+    ROW_FALLS,
+    AVX2_ROW_FALLS,
+    TOTAL_FALL_KERNELS
+} fall_kernels;
+
+static const int max_stamina = 1000;
+static const int starting_money = 0;
+
+static const type max_pickaxe_tier = 6;
+static const type max_bag_tier = 4;
+
+static const int max_fall_distance = 6;
+
+static const int player_start_x = 2;
+static const int player_start_y = 1;
+
+/*
+ * Per-player fields, each one is stored as a contiguous array across all the
+ * instances of a batch so stepping a batch walks them linearly
+ */
+typedef enum {
+    PLAYER_X = DEFAULT,
+    PLAYER_Y,
+    PLAYER_SCR_X,
+    PLAYER_SCR_Y,
+    CAMERA_X,
+    CAMERA_Y,
+    MONEY,
+    STAMINA,
+    INV_ORE,
+    INV_SUPPORTS,
+    INV_LADDERS,
+    INV_COFFEE,
+    INV_DYNAMITE,
+    MAX_ORE,
+    MAX_SUPPORTS,
+    MAX_LADDERS,
+    MAX_COFFEE,
+    MAX_DYNAMITE,
+    TOTAL_BLOCKS_MINED,
+    TOTAL_ORE_MINED,
+    TOTAL_MONEY_EARNED,
+    TOTAL_MONEY_SPENT,
+    COFFEE_BOUGHT,
+    DYNAMITE_BOUGHT,
+    SUPPORTS_BOUGHT,
+    LADDERS_BOUGHT,
+    COFFEE_USED,
+    DYNAMITE_USED,
+    STRUCTURES_PLACED,
+    SUPPORTS_PLACED,
+    LADDERS_PLACED,
+    TIMES_RESCUED,
+    MONEY_SPENT_ON_RESCUES,
+    TIMES_OUT_OF_STAMINA,
+    TIMES_CRUSHED_BY_ROCK,
+    TIMES_FALLEN,
+    INV_INDV_ORE,
+    TOTAL_INDV_ORE_MINED = INV_INDV_ORE + TOTAL_ORE,
+    TOTAL_PLAYER_INTS = TOTAL_INDV_ORE_MINED + TOTAL_ORE
+} player_ints;
+
+typedef enum {
+    PLAYER_ACTION = DEFAULT,
+    PLAYER_SELECTED_STRUCTURE,
+    PLAYER_BAG_TIER,
+    PLAYER_PICKAXE_TIER,
+    AUTODIG,
+    TOTAL_PLAYER_TYPES
+} player_types;
+
+typedef struct miner_batch miner_batch;
+
+typedef struct {
+    miner_batch* batch;
+    int slot;
+
+    unsigned int seed;
+
+    /* Keys passed to miner_step() since the game started */
+    unsigned int steps;
+
+    /*
+     * Zobrist hash of the mine and the player fields, kept up to date by
+     * every write so two states compare without walking the mine. Cells
+     * still as generated hash to 0 so generating chunks never touches it.
+     * The camera follows the terminal so its fields are left out
+     */
+    unsigned long long mine_hash;
+    unsigned long long player_hash;
+
+    /* The camera scrolls to keep the player a quarter of the way inside */
+    int camera_width;
+    int camera_height;
+
+    chunk_map chunks;
+    chunk_entry recent_chunks[RECENT_CHUNKS];
+    health_map healths;
+
+    /* Format of the loaded save, chunks of a mapped save live in the mapping */
+    type save_format;
+    void* mapped_save;
+    size_t mapped_save_size;
+
+    /*
+     * Falling rocks wait in the slot of the tick they drop on so a tick only
+     * visits the rocks that are due
+     */
+    rock_slot falling_rocks[FALL_WHEEL_SIZE];
+    unsigned int rock_tick;
+
+    type selected_menu_action;
+    type selected_shop_action;
+
+    boolean game_running;
+    boolean menu;
+    boolean shop;
+
+    type notice;
+
+    /* Set by the step that sent the player back to the surface */
+    boolean rescued;
+
+    /* What the last rescue looked like, for the front end to replay it */
+    type rescue_reason;
+    type rescue_block;
+    int rescue_x;
+    int rescue_y;
+    int rescue_scr_x;
+    int rescue_scr_y;
+    int rescue_camera_x;
+    int rescue_camera_y;
+    int rescue_price;
+
+    int ore_sold_for;
+} miner_state;
+
+struct miner_batch {
+    int count;
+    int* ints[TOTAL_PLAYER_INTS];
+    type* types[TOTAL_PLAYER_TYPES];
+    miner_state* states;
+};
+
+#define PLAYER_INT(s, f) ((s)->batch->ints[f][(s)->slot])
+#define PLAYER_TYPE(s, f) ((s)->batch->types[f][(s)->slot])
+
+miner_batch* miner_batch_new(int count);
+void miner_batch_free(miner_batch* b);
+
+void miner_batch_new_games(miner_batch* b, const unsigned int* seeds);
+void miner_step_batch(miner_batch* b, const int* keys);
+
+void miner_init(miner_state* s);
+void miner_new_game(miner_state* s, unsigned int seed, int width, int height);
+void miner_generate(miner_state* s, int width, int height, int threads);
+
+void miner_step(miner_state* s, int key);
+void miner_set_viewport(miner_state* s, int width, int height);
+
+unsigned long long miner_hash(miner_state* s);
+/* Recomputes the hash from scratch, to check the incremental one */
+unsigned long long miner_rehash(miner_state* s);
+
+/*
+ * The fastest fall kernel the CPU supports is picked by miner_batch_new(),
+ * every kernel leaves the mine exactly like ROCK_FALLS
+ */
+boolean miner_fall_kernel_supported(type kernel);
+void miner_use_fall_kernel(type kernel);
+type miner_fall_kernel();
+const char* miner_fall_kernel_name(type kernel);
+
+boolean miner_save(miner_state* s, const char* fn, type format);
+boolean miner_load(miner_state* s, const char* fn);
+
+/* Save and load at the current position of an open file */
+boolean miner_save_stream(miner_state* s, FILE* f, type format);
+boolean miner_load_stream(miner_state* s, FILE* f);
+
+/* The cell the way saves store it, with VISIBLE in its type */
+block miner_get_block(miner_state* s, int x, int y);
+
+/*
+ * Writes a cell through the core so the hash and the stop planes keep up, a
+ * FALLING_ROCK drops like a rock that was just dug under. For tools and
+ * benches that need mines the generator never makes
+ */
+void miner_put_block(miner_state* s, int x, int y, type block_type);
+
+type miner_block_type(miner_state* s, int x, int y);
+boolean miner_is_visible(miner_state* s, int x, int y);
+char miner_symbol(type t);
+unsigned char miner_color(type t);
+
+const pickaxe* miner_pickaxe_data(type t);
+int miner_bag_price(type t);
+
+#endif /* MINER_H */
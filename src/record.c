@@ -0,0 +1,231 @@
+#include "record.h"
+#include "generate.h"
+
+#define RECORD_MAGIC "MREC"
+#define RECORD_VERSION 3
+
+#define KEYFRAME_MAGIC "MKFI"
+#define KEYFRAME_VERSION 3
+
+#define RECORD_ENTRY_SIZE (sizeof(unsigned int) + 1)
+
+typedef struct {
+    char magic[4];
+    int version;
+    int generator_version;
+    unsigned int seed;
+    unsigned long long id;
+} record_header;
+
+typedef struct {
+    char magic[4];
+    int version;
+    unsigned int interval;
+    unsigned long long id;
+} keyframe_header;
+
+typedef struct {
+    unsigned int action;
+    long offset;
+} keyframe_entry;
+
+/* The wall clock, process and seed are mixed so two recordings never share an id */
+static unsigned long long new_id(unsigned int seed)
+{
+    struct timespec now;
+    unsigned long long ns;
+    clock_gettime(CLOCK_REALTIME, &now);
+    ns = (unsigned long long)now.tv_sec * 1000000000ull + (unsigned long long)now.tv_nsec;
+    return mix64(ns ^ mix64((unsigned long long)getpid() << 32 | seed));
+}
+
+boolean record_open(recorder* r, const char* fn, unsigned int seed)
+{
+    record_header h;
+    r->f = fopen(fn, "wb");
+    if(r->f == NULL) return False;
+    memcpy(h.magic, RECORD_MAGIC, sizeof(h.magic));
+    h.version = RECORD_VERSION;
+    h.generator_version = GENERATOR_VERSION;
+    h.seed = seed;
+    h.id = new_id(seed);
+    clock_gettime(CLOCK_MONOTONIC, &r->start);
+    if(fwrite(&h, sizeof(record_header), 1, r->f) != 1) {
+        record_close(r);
+        return False;
+    }
+    return True;
+}
+
+/* Every entry is the 4 byte timestamp followed by the key byte */
+boolean record_key(recorder* r, int key)
+{
+    struct timespec now;
+    unsigned int ms;
+    unsigned char k = (unsigned char)key;
+    if(r->f == NULL) return False;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ms = (unsigned int)((now.tv_sec - r->start.tv_sec) * 1000 + (now.tv_nsec - r->start.tv_nsec) / 1000000);
+    return (boolean)(fwrite(&ms, sizeof(unsigned int), 1, r->f) == 1 && fwrite(&k, 1, 1, r->f) == 1);
+}
+
+void record_close(recorder* r)
+{
+    if(r->f != NULL) fclose(r->f);
+    r->f = NULL;
+}
+
+boolean replay_open(replayer* r, const char* fn)
+{
+    record_header h;
+    r->f = fopen(fn, "rb");
+    if(r->f == NULL) return False;
+    if(fread(&h, sizeof(record_header), 1, r->f) != 1
+       || memcmp(h.magic, RECORD_MAGIC, sizeof(h.magic)) != 0
+       || h.version != RECORD_VERSION
+       || h.generator_version != GENERATOR_VERSION) {
+        replay_close(r);
+        return False;
+    }
+    r->seed = h.seed;
+    r->id = h.id;
+    return True;
+}
+
+boolean replay_next(replayer* r, unsigned int* ms, int* key)
+{
+    unsigned char k;
+    if(fread(ms, sizeof(unsigned int), 1, r->f) != 1 || fread(&k, 1, 1, r->f) != 1) return False;
+    *key = k;
+    return True;
+}
+
+void replay_close(replayer* r)
+{
+    if(r->f != NULL) fclose(r->f);
+    r->f = NULL;
+}
+
+boolean replay_skip(replayer* r, unsigned int action)
+{
+    return (boolean)(fseek(r->f, (long)(sizeof(record_header) + action * RECORD_ENTRY_SIZE), SEEK_SET) == 0);
+}
+
+static boolean keyframe_names(const char* record_fn, const char* suffix, char* states_fn, char* index_fn)
+{
+    return snprintf(states_fn, FILENAME_MAX, "%s.kf%s", record_fn, suffix) < FILENAME_MAX
+           && snprintf(index_fn, FILENAME_MAX, "%s.idx%s", record_fn, suffix) < FILENAME_MAX;
+}
+
+/*
+ * Opens the index in index_fn if it was made from the recording id, leaving
+ * it right after the header and setting how many keyframes it holds
+ */
+static FILE* open_index(const char* index_fn, unsigned long long id, keyframe_header* h, long* count)
+{
+    long size;
+    FILE* index = fopen(index_fn, "rb");
+    if(index == NULL) return NULL;
+    if(fread(h, sizeof(keyframe_header), 1, index) != 1
+       || memcmp(h->magic, KEYFRAME_MAGIC, sizeof(h->magic)) != 0
+       || h->version != KEYFRAME_VERSION || h->id != id || h->interval == 0
+       || fseek(index, 0, SEEK_END) != 0 || (size = ftell(index)) < 0
+       || fseek(index, (long)sizeof(keyframe_header), SEEK_SET) != 0) {
+        fclose(index);
+        return NULL;
+    }
+    *count = (size - (long)sizeof(keyframe_header)) / (long)sizeof(keyframe_entry);
+    return index;
+}
+
+boolean keyframes_open(keyframes* k, const char* record_fn, replayer* r)
+{
+    char states_fn[FILENAME_MAX], index_fn[FILENAME_MAX];
+    keyframe_header h;
+    k->states = NULL;
+    k->index = NULL;
+    k->record_fn = record_fn;
+    k->count = 0;
+    k->id = r->id;
+    if(!keyframe_names(record_fn, ".tmp", states_fn, index_fn)) return False;
+    k->states = fopen(states_fn, "wb");
+    k->index = fopen(index_fn, "wb");
+    memcpy(h.magic, KEYFRAME_MAGIC, sizeof(h.magic));
+    h.version = KEYFRAME_VERSION;
+    h.interval = KEYFRAME_INTERVAL;
+    h.id = k->id;
+    if(k->states == NULL || k->index == NULL || fwrite(&h, sizeof(keyframe_header), 1, k->index) != 1) {
+        keyframes_close(k);
+        return False;
+    }
+    return True;
+}
+
+/* Delta saves keep every keyframe down to the chunks the player changed */
+boolean keyframes_add(keyframes* k, miner_state* s, unsigned int action)
+{
+    keyframe_entry e;
+    e.action = action;
+    e.offset = ftell(k->states);
+    if(e.offset < 0 || !miner_save_stream(s, k->states, DELTA_SAVE)
+       || fwrite(&e, sizeof(keyframe_entry), 1, k->index) != 1) return False;
+    k->count++;
+    return True;
+}
+
+/*
+ * The keyframes are written next to the old ones and only replace them if
+ * there are at least as many, so a replay that stops early keeps a longer
+ * index. The old index goes first so a crash never pairs it with new states
+ */
+void keyframes_close(keyframes* k)
+{
+    char states_fn[FILENAME_MAX], index_fn[FILENAME_MAX];
+    char tmp_states_fn[FILENAME_MAX], tmp_index_fn[FILENAME_MAX];
+    keyframe_header h;
+    long count = 0;
+    boolean written = (boolean)(k->states != NULL && k->index != NULL);
+    FILE* old;
+    if(k->states != NULL && fclose(k->states) != 0) written = False;
+    if(k->index != NULL && fclose(k->index) != 0) written = False;
+    k->states = NULL;
+    k->index = NULL;
+    if(k->record_fn == NULL || !keyframe_names(k->record_fn, "", states_fn, index_fn)
+       || !keyframe_names(k->record_fn, ".tmp", tmp_states_fn, tmp_index_fn)) return;
+    k->record_fn = NULL;
+    old = open_index(index_fn, k->id, &h, &count);
+    if(old != NULL) fclose(old);
+    if(written && k->count >= count && (old == NULL || remove(index_fn) == 0)
+       && rename(tmp_states_fn, states_fn) == 0 && rename(tmp_index_fn, index_fn) == 0) return;
+    remove(tmp_states_fn);
+    remove(tmp_index_fn);
+}
+
+boolean keyframes_seek(const char* record_fn, replayer* r, miner_state* s, unsigned int* action)
+{
+    char states_fn[FILENAME_MAX], index_fn[FILENAME_MAX];
+    keyframe_header h;
+    keyframe_entry e;
+    long count, i;
+    FILE* index;
+    FILE* states;
+    boolean loaded;
+    if(!keyframe_names(record_fn, "", states_fn, index_fn)) return False;
+    index = open_index(index_fn, r->id, &h, &count);
+    if(index == NULL) return False;
+    i = (long)(*action / h.interval);
+    if(i >= count) i = count - 1;
+    if(i < 0 || fseek(index, (long)sizeof(keyframe_header) + i * (long)sizeof(keyframe_entry), SEEK_SET) != 0
+       || fread(&e, sizeof(keyframe_entry), 1, index) != 1 || e.action > *action) {
+        fclose(index);
+        return False;
+    }
+    fclose(index);
+    states = fopen(states_fn, "rb");
+    if(states == NULL) return False;
+    loaded = fseek(states, e.offset, SEEK_SET) == 0 && miner_load_stream(s, states);
+    fclose(states);
+    if(!loaded || !replay_skip(r, e.action)) return False;
+    *action = e.action;
+    return True;
+}
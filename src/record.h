@@ -0,0 +1,63 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include "util.h"
+#include "miner.h"
+
+#define KEYFRAME_INTERVAL 10000
+
+/*
+ * Recordings hold the seed of a new game and every key the front end read,
+ * with the milliseconds since the recording started, so a session can be
+ * played back exactly or as fast as the core steps
+ */
+typedef struct {
+    FILE* f;
+    struct timespec start;
+} recorder;
+
+/*
+ * Every recording gets an id when it is opened, keyframes are only loaded
+ * for the recording with their id
+ */
+typedef struct {
+    FILE* f;
+    unsigned int seed;
+    unsigned long long id;
+} replayer;
+
+/*
+ * Keyframes of the game state every KEYFRAME_INTERVAL actions of a replay,
+ * kept next to the recording in FILE.kf with an index of where every one
+ * starts in FILE.idx. Only the recording they were made from loads them
+ */
+typedef struct {
+    FILE* states;
+    FILE* index;
+    const char* record_fn;
+    long count;
+    unsigned long long id;
+} keyframes;
+
+boolean record_open(recorder* r, const char* fn, unsigned int seed);
+boolean record_key(recorder* r, int key);
+void record_close(recorder* r);
+
+boolean replay_open(replayer* r, const char* fn);
+/* False at the end of the recording */
+boolean replay_next(replayer* r, unsigned int* ms, int* key);
+void replay_close(replayer* r);
+/* Moves the replay to just before the action with the given number */
+boolean replay_skip(replayer* r, unsigned int action);
+
+boolean keyframes_open(keyframes* k, const char* record_fn, replayer* r);
+boolean keyframes_add(keyframes* k, miner_state* s, unsigned int action);
+void keyframes_close(keyframes* k);
+
+/*
+ * Loads the last keyframe at or before action into s and moves the replay
+ * there, action is set to the action the keyframe was taken at
+ */
+boolean keyframes_seek(const char* record_fn, replayer* r, miner_state* s, unsigned int* action);
+
+#endif /* RECORD_H */
@@ -0,0 +1,227 @@
+#include "render.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PRINTW_BUFFER_SIZE 256
+
+static const renderer* renderers_list[TOTAL_RENDERERS] = {
+    &curses_renderer,
+    &ansi_renderer
+};
+
+static const char* renderer_names[TOTAL_RENDERERS] = {
+    "curses",
+    "ansi"
+};
+
+#if defined USE_ANSI_RENDERER
+static type current_renderer = ANSI_RENDERER;
+#else
+static type current_renderer = CURSES_RENDERER;
+#endif
+
+void render_use(type r)
+{
+    if(r < TOTAL_RENDERERS) current_renderer = r;
+}
+
+type render_current()
+{
+    return current_renderer;
+}
+
+const char* render_name(type r)
+{
+    return (r < TOTAL_RENDERERS) ? renderer_names[r] : "none";
+}
+
+void render_init()
+{
+    renderers_list[current_renderer]->init();
+    invscrb();
+}
+
+void render_end()
+{
+    renderers_list[current_renderer]->end();
+}
+
+void render_erase()
+{
+    renderers_list[current_renderer]->erase();
+}
+
+void render_move(int y, int x)
+{
+    renderers_list[current_renderer]->move(y, x);
+}
+
+void render_color(unsigned char color)
+{
+    renderers_list[current_renderer]->color(color);
+}
+
+void render_addch(char c)
+{
+    renderers_list[current_renderer]->addch(c);
+}
+
+void render_printw(const char* fmt, ...)
+{
+    char str[PRINTW_BUFFER_SIZE];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(str, sizeof(str), fmt, ap);
+    va_end(ap);
+    renderers_list[current_renderer]->addstr(str);
+}
+
+void render_clrtoeol()
+{
+    renderers_list[current_renderer]->clrtoeol();
+}
+
+void render_refresh()
+{
+    renderers_list[current_renderer]->refresh();
+}
+
+int render_getch()
+{
+    return renderers_list[current_renderer]->getch();
+}
+
+void render_size(int* width, int* height)
+{
+    renderers_list[current_renderer]->size(width, height);
+}
+
+typedef struct {
+    char c;
+    unsigned char color;
+} colorchar;
+
+static colorchar* screen_buffer = NULL;
+static int screen_width = 0;
+static int screen_height = 0;
+
+/*
+ * What the terminal is showing, prtscrb() only emits the cells that differ
+ * from it and changes the color once per run of the same color
+ */
+static colorchar* shown_buffer = NULL;
+static boolean shown_valid = False;
+
+boolean rszscrb(int width, int height)
+{
+    size_t cells = (size_t)width * height;
+    colorchar* screen = realloc(screen_buffer, cells * sizeof(colorchar));
+    colorchar* shown;
+    if(screen == NULL) return False;
+    screen_buffer = screen;
+    shown = realloc(shown_buffer, cells * sizeof(colorchar));
+    if(shown == NULL) return False;
+    shown_buffer = shown;
+    screen_width = width;
+    screen_height = height;
+    shown_valid = False;
+    clrscrb();
+    return True;
+}
+
+void wrtscrb(int x, int y, char c, unsigned char color)
+{
+    colorchar* cell = &screen_buffer[y * screen_width + x];
+    cell->c = c;
+    cell->color = color;
+}
+
+void clrscrb()
+{
+    for(int i = 0; i < screen_width * screen_height; i++) {
+        screen_buffer[i].c = SCRBUF_BLANK_CHAR;
+        screen_buffer[i].color = SCRBUF_BLANK_COLOR;
+    }
+}
+
+void invscrb()
+{
+    shown_valid = False;
+}
+
+/* Terminals scroll a row sideways with two moves and two edits */
+#define ROW_SCROLL_COST 4
+
+static boolean blank_cell(colorchar* c)
+{
+    return (boolean)(c->c == SCRBUF_BLANK_CHAR && c->color == SCRBUF_BLANK_COLOR);
+}
+
+static boolean same_cell(colorchar* a, colorchar* b)
+{
+    return (boolean)(a->c == b->c && a->color == b->color);
+}
+
+boolean scrlscrb(int dx, int dy, int line_cost)
+{
+    int stay = 0, scroll = (dy != 0) ? line_cost : screen_height * ROW_SCROLL_COST;
+    if(!shown_valid || (dx != 0) == (dy != 0) || dx < -1 || dx > 1 || dy < -1 || dy > 1) return False;
+    for(int y = 0; y < screen_height; y++) {
+        for(int x = 0; x < screen_width; x++) {
+            colorchar* c = &screen_buffer[y * screen_width + x];
+            int from_x = x - dx, from_y = y - dy;
+            if(!same_cell(c, &shown_buffer[y * screen_width + x])) stay++;
+            if(from_x < 0 || from_x >= screen_width || from_y < 0 || from_y >= screen_height) {
+                if(!blank_cell(c)) scroll++;
+            } else if(!same_cell(c, &shown_buffer[from_y * screen_width + from_x])) scroll++;
+        }
+    }
+    if(scroll >= stay) return False;
+    renderers_list[current_renderer]->scroll(dx, dy, screen_width, screen_height);
+    if(dy != 0) {
+        size_t row = (size_t)screen_width * sizeof(colorchar);
+        colorchar* exposed = shown_buffer + ((dy > 0) ? 0 : (screen_height - 1) * screen_width);
+        if(dy > 0) memmove(shown_buffer + screen_width, shown_buffer, row * (screen_height - 1));
+        else memmove(shown_buffer, shown_buffer + screen_width, row * (screen_height - 1));
+        for(int x = 0; x < screen_width; x++) {
+            exposed[x].c = SCRBUF_BLANK_CHAR;
+            exposed[x].color = SCRBUF_BLANK_COLOR;
+        }
+    } else {
+        for(int y = 0; y < screen_height; y++) {
+            colorchar* row = shown_buffer + y * screen_width;
+            colorchar* exposed = row + ((dx > 0) ? 0 : screen_width - 1);
+            if(dx > 0) memmove(row + 1, row, (screen_width - 1) * sizeof(colorchar));
+            else memmove(row, row + 1, (screen_width - 1) * sizeof(colorchar));
+            exposed->c = SCRBUF_BLANK_CHAR;
+            exposed->color = SCRBUF_BLANK_COLOR;
+        }
+    }
+    return (boolean)(dy != 0);
+}
+
+void prtscrb()
+{
+    int color = -1;
+    int next_x;
+    for(int y = 0; y < screen_height; y++) {
+        next_x = -1;
+        for(int x = 0; x < screen_width; x++) {
+            colorchar* c = &screen_buffer[y * screen_width + x];
+            colorchar* shown = &shown_buffer[y * screen_width + x];
+            if(shown_valid && c->c == shown->c && c->color == shown->color) continue;
+            if(x != next_x) render_move(y, x);
+            if(c->color != color) {
+                color = c->color;
+                render_color(color);
+            }
+            render_addch(c->c);
+            *shown = *c;
+            next_x = x + 1;
+        }
+    }
+    if(color != -1 && color != DEFAULT_COLOR) render_color(DEFAULT_COLOR);
+    shown_valid = True;
+}
@@ -0,0 +1,87 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "util.h"
+
+#define SCRBUF_BLANK_CHAR ' '
+#define SCRBUF_BLANK_COLOR 0
+
+/* Color 0 is the terminal's own foreground, every other one is a 256 color */
+#define DEFAULT_COLOR 0
+
+/* What getch() returns once the terminal was resized, never a game key */
+#define RESIZE_KEY (-2)
+
+/*
+ * What getch() returns when no key could be read or another signal cut the
+ * wait short, never a game key either
+ */
+#define NO_KEY (-1)
+
+typedef enum {
+    CURSES_RENDERER = DEFAULT,
+    ANSI_RENDERER,
+    TOTAL_RENDERERS
+} renderers;
+
+/*
+ * The terminal calls the game draws with, shaped after the ncurses ones it
+ * used to make directly. Nothing is guaranteed to reach the terminal before
+ * refresh() or getch()
+ */
+typedef struct {
+    void (*init)();
+    void (*end)();
+    void (*erase)();
+    void (*move)(int y, int x);
+    void (*color)(unsigned char color);
+    void (*addch)(char c);
+    void (*addstr)(const char* str);
+    void (*clrtoeol)();
+    void (*refresh)();
+    int (*getch)();
+    void (*size)(int* width, int* height);
+    /*
+     * Moves what the terminal shows in the top left width by height cells
+     * one cell along x or y, leaving blanks behind. Moving along y scrolls
+     * the whole lines, moving along x keeps the rest of every line in place
+     */
+    void (*scroll)(int dx, int dy, int width, int height);
+} renderer;
+
+extern const renderer curses_renderer;
+extern const renderer ansi_renderer;
+
+/* Builds with USE_ANSI_RENDERER default to the ANSI backend */
+void render_use(type r);
+type render_current();
+const char* render_name(type r);
+
+void render_init();
+void render_end();
+void render_erase();
+void render_move(int y, int x);
+void render_color(unsigned char color);
+void render_addch(char c);
+void render_printw(const char* fmt, ...);
+void render_clrtoeol();
+void render_refresh();
+int render_getch();
+void render_size(int* width, int* height);
+
+/* Reallocates the screen buffer, it starts out empty */
+boolean rszscrb(int width, int height);
+void wrtscrb(int x, int y, char c, unsigned char color);
+void clrscrb();
+/* Call after anything else draws over the viewport so it is repainted */
+void invscrb();
+/*
+ * Scrolls what the terminal shows of the screen buffer one cell along x or
+ * y if that leaves less to redraw than not scrolling, line_cost is what
+ * redrawing the rest of the scrolled lines costs in cells. Returns whether
+ * the whole lines were scrolled and have to be redrawn past the buffer
+ */
+boolean scrlscrb(int dx, int dy, int line_cost);
+void prtscrb();
+
+#endif /* RENDER_H */
@@ -0,0 +1,233 @@
+#include "render.h"
+
+#include <termios.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/select.h>
+
+/*
+ * Builds every frame in one buffer and hands it to the terminal with a
+ * single write() on refresh(), only falling back to more writes if a frame
+ * outgrows FRAME_BUFFER_SIZE. The escape sequence of every color is built
+ * once up front
+ */
+#define FRAME_BUFFER_SIZE 65536
+#define COLOR_SEQ_SIZE 12
+
+#define FALLBACK_WIDTH 80
+#define FALLBACK_HEIGHT 24
+
+#define ANSI_ENTER "\033[?1049h\033[?25l\033[H\033[2J"
+#define ANSI_LEAVE "\033[0m\033[?25h\033[?1049l"
+#define ANSI_ERASE "\033[0m\033[H\033[2J"
+#define ANSI_CLRTOEOL "\033[K"
+#define ANSI_DEFAULT_COLOR "\033[39m"
+
+static char frame[FRAME_BUFFER_SIZE];
+static int frame_len = 0;
+
+static char color_seqs[256][COLOR_SEQ_SIZE];
+static int color_seq_lens[256];
+static int current_color = -1;
+
+static struct termios saved_termios;
+static boolean termios_saved = False;
+
+static volatile sig_atomic_t resized = 0;
+
+static void winch_handler(int sigtype)
+{
+    resized = 1;
+}
+
+static void ansi_flush()
+{
+    int written = 0;
+    ssize_t n;
+    while(written < frame_len) {
+        n = write(STDOUT_FILENO, frame + written, frame_len - written);
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            break;
+        }
+        written += (int)n;
+    }
+    frame_len = 0;
+}
+
+static void put(const char* str, int len)
+{
+    if(frame_len + len > FRAME_BUFFER_SIZE) ansi_flush();
+    memcpy(frame + frame_len, str, len);
+    frame_len += len;
+}
+
+#define put_literal(str) put(str, (int)sizeof(str) - 1)
+
+static void ansi_init()
+{
+    struct termios raw;
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = winch_handler;
+    sigaction(SIGWINCH, &sa, 0);
+    strcpy(color_seqs[DEFAULT_COLOR], ANSI_DEFAULT_COLOR);
+    color_seq_lens[DEFAULT_COLOR] = (int)strlen(ANSI_DEFAULT_COLOR);
+    for(int i = 1; i < 256; i++) {
+        color_seq_lens[i] = snprintf(color_seqs[i], COLOR_SEQ_SIZE, "\033[38;5;%dm", i);
+    }
+    if(tcgetattr(STDIN_FILENO, &saved_termios) == 0) {
+        termios_saved = True;
+        raw = saved_termios;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_oflag &= ~OPOST;
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+    }
+    frame_len = 0;
+    current_color = -1;
+    put_literal(ANSI_ENTER);
+}
+
+static void ansi_end()
+{
+    put_literal(ANSI_LEAVE);
+    ansi_flush();
+    if(termios_saved) tcsetattr(STDIN_FILENO, TCSAFLUSH, &saved_termios);
+    termios_saved = False;
+    signal(SIGWINCH, SIG_DFL);
+}
+
+static void ansi_erase()
+{
+    put_literal(ANSI_ERASE);
+    current_color = DEFAULT_COLOR;
+}
+
+static void ansi_move(int y, int x)
+{
+    char seq[24];
+    put(seq, snprintf(seq, sizeof(seq), "\033[%d;%dH", y + 1, x + 1));
+}
+
+static void ansi_color(unsigned char color)
+{
+    if(color == current_color) return;
+    put(color_seqs[color], color_seq_lens[color]);
+    current_color = color;
+}
+
+/* A newline clears the rest of the line like it does in ncurses */
+static void ansi_addch(char c)
+{
+    if(c == '\n') put_literal(ANSI_CLRTOEOL "\r\n");
+    else put(&c, 1);
+}
+
+static void ansi_addstr(const char* str)
+{
+    const char* nl;
+    while((nl = strchr(str, '\n')) != NULL) {
+        put(str, (int)(nl - str));
+        ansi_addch('\n');
+        str = nl + 1;
+    }
+    put(str, (int)strlen(str));
+}
+
+static void ansi_clrtoeol()
+{
+    put_literal(ANSI_CLRTOEOL);
+}
+
+static void ansi_refresh()
+{
+    if(frame_len > 0) ansi_flush();
+}
+
+/*
+ * Like ncurses, waiting for a key shows what has been drawn so far and a
+ * SIGWINCH interrupts the wait to report the resize. SIGWINCH stays blocked
+ * outside of pselect() so one arriving right before the wait still ends it,
+ * any other signal ends the wait with NO_KEY so the caller can look at what
+ * it changed
+ */
+static int ansi_getch()
+{
+    unsigned char c;
+    sigset_t winch, old;
+    fd_set fds;
+    ssize_t n;
+    int key = NO_KEY;
+    ansi_refresh();
+    sigemptyset(&winch);
+    sigaddset(&winch, SIGWINCH);
+    sigprocmask(SIG_BLOCK, &winch, &old);
+    if(!resized) {
+        FD_ZERO(&fds);
+        FD_SET(STDIN_FILENO, &fds);
+        if(pselect(STDIN_FILENO + 1, &fds, NULL, NULL, NULL, &old) > 0) {
+            do n = read(STDIN_FILENO, &c, 1);
+            while(n < 0 && errno == EINTR);
+            if(n == 1) key = c;
+        }
+    }
+    if(key == NO_KEY && resized) {
+        resized = 0;
+        key = RESIZE_KEY;
+    }
+    sigprocmask(SIG_SETMASK, &old, NULL);
+    return key;
+}
+
+static void ansi_size(int* width, int* height)
+{
+    struct winsize ws;
+    if(ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 0) {
+        *width = ws.ws_col;
+        *height = ws.ws_row;
+    } else {
+        *width = FALLBACK_WIDTH;
+        *height = FALLBACK_HEIGHT;
+    }
+}
+
+/*
+ * Scrolls lines inside a scroll region, a row moves sideways by deleting a
+ * character at one edge of the viewport and inserting one at the other
+ */
+static void ansi_scroll(int dx, int dy, int width, int height)
+{
+    char seq[24];
+    if(dy != 0) {
+        put(seq, snprintf(seq, sizeof(seq), "\033[1;%dr", height));
+        if(dy > 0) put_literal("\033[T");
+        else put_literal("\033[S");
+        put_literal("\033[r");
+        return;
+    }
+    for(int y = 0; y < height; y++) {
+        ansi_move(y, (dx > 0) ? width - 1 : 0);
+        put_literal("\033[P");
+        ansi_move(y, (dx > 0) ? 0 : width - 1);
+        put_literal("\033[@");
+    }
+}
+
+const renderer ansi_renderer = {
+    ansi_init,
+    ansi_end,
+    ansi_erase,
+    ansi_move,
+    ansi_color,
+    ansi_addch,
+    ansi_addstr,
+    ansi_clrtoeol,
+    ansi_refresh,
+    ansi_getch,
+    ansi_size,
+    ansi_scroll
+};
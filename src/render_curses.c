@@ -0,0 +1,120 @@
+#include "render.h"
+
+#include <ncurses.h>
+
+/* Color pairs are made the first time a color is used, pair n is color n */
+static boolean paired[256];
+
+static void curses_init()
+{
+    initscr();
+    cbreak();
+    noecho();
+    keypad(stdscr, TRUE);
+    curs_set(0);
+    idlok(stdscr, TRUE);
+    start_color();
+    use_default_colors();
+    memset(paired, 0, sizeof(paired));
+    erase();
+}
+
+static void curses_end()
+{
+    endwin();
+}
+
+static void curses_erase()
+{
+    erase();
+}
+
+static void curses_move(int y, int x)
+{
+    move(y, x);
+}
+
+static void curses_color(unsigned char color)
+{
+    if(color == DEFAULT_COLOR) {
+        attrset(A_NORMAL);
+        return;
+    }
+    if(!paired[color]) {
+        init_pair(color, color, -1);
+        paired[color] = True;
+    }
+    attrset(COLOR_PAIR(color));
+}
+
+static void curses_addch(char c)
+{
+    addch(c);
+}
+
+static void curses_addstr(const char* str)
+{
+    addstr(str);
+}
+
+static void curses_clrtoeol()
+{
+    clrtoeol();
+}
+
+static void curses_refresh()
+{
+    refresh();
+}
+
+/* ncurses catches SIGWINCH itself and reports it as KEY_RESIZE */
+static int curses_getch()
+{
+    int key = getch();
+    if(key == KEY_RESIZE) return RESIZE_KEY;
+    return (key == ERR) ? NO_KEY : key;
+}
+
+static void curses_size(int* width, int* height)
+{
+    getmaxyx(stdscr, *height, *width);
+}
+
+/*
+ * Scrolls the virtual screen and refreshes straight away, while every line
+ * still matches one already on the terminal, so ncurses finds the scroll
+ * and the character insertions instead of repainting
+ */
+static void curses_scroll(int dx, int dy, int width, int height)
+{
+    if(dy != 0) {
+        setscrreg(0, height - 1);
+        scrollok(stdscr, TRUE);
+        scrl(-dy);
+        scrollok(stdscr, FALSE);
+        setscrreg(0, LINES - 1);
+    } else {
+        for(int y = 0; y < height; y++) {
+            move(y, (dx > 0) ? width - 1 : 0);
+            delch();
+            move(y, (dx > 0) ? 0 : width - 1);
+            insch(' ');
+        }
+    }
+    refresh();
+}
+
+const renderer curses_renderer = {
+    curses_init,
+    curses_end,
+    curses_erase,
+    curses_move,
+    curses_color,
+    curses_addch,
+    curses_addstr,
+    curses_clrtoeol,
+    curses_refresh,
+    curses_getch,
+    curses_size,
+    curses_scroll
+};
@@ -46,3 +46,37 @@ unsigned int randint()
     random_seed ^= random_seed << 5;
     return random_seed;
 }
+
+unsigned int mix32(unsigned int x)
+{
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+unsigned long long mix64(unsigned long long x)
+{
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+int lowest_bit(unsigned int x)
+{
+#if defined __GNUC__
+    return __builtin_ctz(x);
+#else
+    int i = 0;
+    while(!(x & 1u)) {
+        x >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
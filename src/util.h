@@ -3,7 +3,7 @@
 
 #ifndef _POSIX_C_SOURCE
 
-#define _POSIX_C_SOURCE 199309L
+#define _POSIX_C_SOURCE 200809L
 
 #endif
 
@@ -63,6 +63,12 @@ inline boolean file_exists(const char* fn)
 
 #endif
 
+unsigned int mix32(unsigned int x);
+unsigned long long mix64(unsigned long long x);
+
+/* Index of the lowest set bit, x must not be 0 */
+int lowest_bit(unsigned int x);
+
 extern unsigned int random_seed;
 
 unsigned int randint();